@@ -0,0 +1,352 @@
+#include "artifact_store.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace {
+
+constexpr char record_magic[] = "CPREC01\n";
+constexpr size_t record_magic_size = sizeof(record_magic) - 1;
+
+uint32_t rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+// clang-format off
+const uint32_t sha256_k[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+// clang-format on
+
+void sha256_block(uint32_t h[8], const unsigned char *block) {
+  uint32_t w[64];
+  for (int i = 0; i < 16; ++i) {
+    w[i] = (uint32_t(block[i * 4]) << 24) | (uint32_t(block[i * 4 + 1]) << 16) |
+           (uint32_t(block[i * 4 + 2]) << 8) | uint32_t(block[i * 4 + 3]);
+  }
+  for (int i = 16; i < 64; ++i) {
+    uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+  uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+  uint32_t e = h[4], f = h[5], g = h[6], k = h[7];
+  for (int i = 0; i < 64; ++i) {
+    uint32_t s1 = rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25);
+    uint32_t ch = (e & f) ^ (~e & g);
+    uint32_t t1 = k + s1 + ch + sha256_k[i] + w[i];
+    uint32_t s0 = rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22);
+    uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+    uint32_t t2 = s0 + maj;
+    k = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+  h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+  h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+template <typename T>
+void append_pod(std::string &out, T value) {
+  out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+template <typename T>
+bool read_pod(const std::string &in, size_t &pos, T &value) {
+  if (pos + sizeof(T) > in.size()) {
+    return false;
+  }
+  std::memcpy(&value, in.data() + pos, sizeof(T));
+  pos += sizeof(T);
+  return true;
+}
+
+bool read_whole_file(const std::filesystem::path &path, std::string &out) {
+  std::ifstream f(path.string(), std::ios::binary);
+  if (!f.is_open()) {
+    return false;
+  }
+  std::stringstream buffer;
+  buffer << f.rdbuf();
+  out = buffer.str();
+  return true;
+}
+
+// Writes next to the destination and renames over it.
+bool write_file_atomically(const std::filesystem::path &path,
+                           const std::string &data) {
+  static std::atomic<uint64_t> tmp_counter{0};
+  std::error_code ec;
+  std::filesystem::create_directories(path.parent_path(), ec);
+  std::stringstream tmp_name;
+  tmp_name << path.filename().string() << ".tmp." << std::this_thread::get_id()
+           << "." << tmp_counter++;
+  std::filesystem::path tmp = path.parent_path() / tmp_name.str();
+  {
+    std::ofstream f(tmp.string(), std::ios::binary);
+    if (!f.is_open()) {
+      return false;
+    }
+    f.write(data.data(), data.size());
+    f.close();
+    if (!f) {
+      std::filesystem::remove(tmp, ec);
+      return false;
+    }
+  }
+  std::filesystem::rename(tmp, path, ec);
+  if (ec) {
+    std::filesystem::remove(tmp, ec);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+std::string sha256_hex(const std::string &data) {
+  uint32_t h[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                   0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+  size_t full = data.size() / 64 * 64;
+  for (size_t i = 0; i < full; i += 64) {
+    sha256_block(h, reinterpret_cast<const unsigned char *>(data.data() + i));
+  }
+  unsigned char tail[128] = {0};
+  size_t rest = data.size() - full;
+  std::memcpy(tail, data.data() + full, rest);
+  tail[rest] = 0x80;
+  size_t tail_size = rest + 9 <= 64 ? 64 : 128;
+  uint64_t bits = uint64_t(data.size()) * 8;
+  for (int i = 0; i < 8; ++i) {
+    tail[tail_size - 1 - i] = (unsigned char)(bits >> (8 * i));
+  }
+  for (size_t i = 0; i < tail_size; i += 64) {
+    sha256_block(h, tail + i);
+  }
+  char buf[65];
+  for (int i = 0; i < 8; ++i) {
+    std::snprintf(buf + i * 8, 9, "%08x", h[i]);
+  }
+  return std::string(buf, 64);
+}
+
+const record_field *submission_record::find(const std::string &name) const {
+  auto it = std::lower_bound(
+      fields.begin(), fields.end(), name,
+      [](const record_field &f, const std::string &n) { return f.name < n; });
+  if (it != fields.end() && it->name == name) {
+    return &*it;
+  }
+  return nullptr;
+}
+
+void submission_record::set(const std::string &name, std::string value,
+                            bool is_blob) {
+  auto it = std::lower_bound(
+      fields.begin(), fields.end(), name,
+      [](const record_field &f, const std::string &n) { return f.name < n; });
+  if (it == fields.end() || it->name != name) {
+    it = fields.insert(it, record_field{name, false, ""});
+  }
+  it->is_blob = is_blob;
+  it->value = std::move(value);
+}
+
+bool submission_record::remove(const std::string &name) {
+  const record_field *f = find(name);
+  if (!f) {
+    return false;
+  }
+  fields.erase(fields.begin() + (f - fields.data()));
+  return true;
+}
+
+std::string submission_record::encode() const {
+  std::string out(record_magic, record_magic_size);
+  append_pod<uint32_t>(out, fields.size());
+  uint64_t offset = 0;
+  for (const record_field &f : fields) {
+    append_pod<uint32_t>(out, f.name.size());
+    out += f.name;
+    append_pod<uint8_t>(out, f.is_blob ? 1 : 0);
+    append_pod<uint64_t>(out, offset);
+    append_pod<uint64_t>(out, f.value.size());
+    offset += f.value.size();
+  }
+  for (const record_field &f : fields) {
+    out += f.value;
+  }
+  return out;
+}
+
+bool submission_record::decode(const std::string &bytes) {
+  fields.clear();
+  if (bytes.compare(0, record_magic_size, record_magic) != 0) {
+    return false;
+  }
+  size_t pos = record_magic_size;
+  uint32_t count;
+  if (!read_pod(bytes, pos, count) || count > bytes.size()) {
+    return false;
+  }
+  struct index_entry {
+    uint64_t offset, size;
+  };
+  std::vector<index_entry> index(count);
+  fields.resize(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t name_size;
+    uint8_t is_blob;
+    if (!read_pod(bytes, pos, name_size) || pos + name_size > bytes.size()) {
+      return false;
+    }
+    fields[i].name = bytes.substr(pos, name_size);
+    pos += name_size;
+    if (!read_pod(bytes, pos, is_blob) ||
+        !read_pod(bytes, pos, index[i].offset) ||
+        !read_pod(bytes, pos, index[i].size)) {
+      return false;
+    }
+    fields[i].is_blob = is_blob != 0;
+  }
+  size_t payload = pos;
+  for (uint32_t i = 0; i < count; ++i) {
+    if (payload + index[i].offset + index[i].size > bytes.size()) {
+      return false;
+    }
+    fields[i].value = bytes.substr(payload + index[i].offset, index[i].size);
+  }
+  return true;
+}
+
+artifact_store::artifact_store(std::filesystem::path root)
+    : root(std::move(root)) {}
+
+std::string artifact_store::put_blob(const std::string &data) {
+  std::string hash = sha256_hex(data);
+  std::filesystem::path path = blob_path(hash);
+  if (!std::filesystem::exists(path)) {
+    if (!write_file_atomically(path, data)) {
+      std::printf("Could not write blob %s.\n", path.c_str());
+      return "";
+    }
+    blob_misses++;
+  } else {
+    blob_hits++;
+  }
+  return hash;
+}
+
+std::filesystem::path artifact_store::blob_path(const std::string &hash) const {
+  return root / "blobs" / hash.substr(0, 2) / hash;
+}
+
+std::string artifact_store::read_blob(const std::string &hash) const {
+  std::string data;
+  read_whole_file(blob_path(hash), data);
+  return data;
+}
+
+bool artifact_store::put(submission_record &record, const std::string &name,
+                         std::string value, bool force_blob) {
+  if (force_blob || value.size() > inline_limit) {
+    std::string hash = put_blob(value);
+    if (hash.empty()) {
+      return false;
+    }
+    record.set(name, hash, true);
+  } else {
+    record.set(name, std::move(value), false);
+  }
+  return true;
+}
+
+bool artifact_store::put_file(submission_record &record,
+                              const std::string &name,
+                              const std::filesystem::path &file,
+                              bool force_blob) {
+  std::string data;
+  if (!read_whole_file(file, data)) {
+    return true;
+  }
+  return put(record, name, std::move(data), force_blob);
+}
+
+std::string artifact_store::get(const submission_record &record,
+                                const std::string &name) const {
+  const record_field *f = record.find(name);
+  if (!f) {
+    return "";
+  }
+  return f->is_blob ? read_blob(f->value) : f->value;
+}
+
+std::filesystem::path artifact_store::blob_file(
+    const submission_record &record, const std::string &name) const {
+  const record_field *f = record.find(name);
+  if (!f || !f->is_blob) {
+    return {};
+  }
+  return blob_path(f->value);
+}
+
+bool artifact_store::extract(const submission_record &record,
+                             const std::string &name,
+                             const std::filesystem::path &file) const {
+  const record_field *f = record.find(name);
+  if (!f) {
+    return false;
+  }
+  std::error_code ec;
+  if (f->is_blob) {
+    std::filesystem::copy_file(
+        blob_path(f->value), file,
+        std::filesystem::copy_options::overwrite_existing, ec);
+    return !ec;
+  }
+  std::ofstream out(file.string(), std::ios::binary);
+  out.write(f->value.data(), f->value.size());
+  return bool(out);
+}
+
+std::filesystem::path artifact_store::record_path(
+    const std::string &task, const std::string &submission_id) const {
+  return root / "submissions" / task / (submission_id + ".rec");
+}
+
+bool artifact_store::has_record(const std::string &task,
+                                const std::string &submission_id) const {
+  return std::filesystem::exists(record_path(task, submission_id));
+}
+
+bool artifact_store::read_record(const std::string &task,
+                                 const std::string &submission_id,
+                                 submission_record &record) const {
+  std::string bytes;
+  if (!read_whole_file(record_path(task, submission_id), bytes)) {
+    return false;
+  }
+  return record.decode(bytes);
+}
+
+bool artifact_store::write_record(const std::string &task,
+                                  const std::string &submission_id,
+                                  const submission_record &record) {
+  return write_file_atomically(record_path(task, submission_id),
+                               record.encode());
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Hex-encoded SHA-256 of the given bytes.
+std::string sha256_hex(const std::string &data);
+
+// One named value in a submission record. Small values are stored inline in
+// the record file; large ones are stored once in the blob store and the record
+// only keeps their hash.
+struct record_field {
+  std::string name;
+  bool is_blob{false};
+  std::string value;  // contents if inline, hash if blob
+};
+
+// All data of one submission, packed into a single indexed file:
+//
+//   "CPREC01\n"                         magic
+//   u32 field count
+//   per field: u32 name length, name, u8 is_blob, u64 offset, u64 size
+//   payload                             offsets are relative to its start
+//
+// Field names are the file names the compile pipeline produces (flags.txt,
+// disassembly.html, ...), so legacy submission directories map 1:1.
+struct submission_record {
+  std::vector<record_field> fields;  // sorted by name
+
+  const record_field *find(const std::string &name) const;
+  void set(const std::string &name, std::string value, bool is_blob);
+  bool remove(const std::string &name);
+
+  std::string encode() const;
+  bool decode(const std::string &bytes);
+};
+
+// Submission storage: one record file per submission under
+// <root>/submissions/<task>/<id>.rec and deduplicated blobs under
+// <root>/blobs/<xx>/<sha256>. All writes go through a temporary file and a
+// rename, so concurrent readers never observe partial files.
+struct artifact_store {
+  static constexpr size_t inline_limit = 4096;
+
+  explicit artifact_store(std::filesystem::path root);
+
+  // Stores the data by hash (if not already present) and returns the hash;
+  // empty if the blob could not be written.
+  std::string put_blob(const std::string &data);
+  std::filesystem::path blob_path(const std::string &hash) const;
+  std::string read_blob(const std::string &hash) const;
+
+  // Stores the value inline or as a blob depending on its size. Forcing a blob
+  // is useful for content that is shared between many submissions. Returns
+  // false, leaving the record unchanged, if the blob could not be written.
+  bool put(submission_record &record, const std::string &name,
+           std::string value, bool force_blob = false);
+  // Like put(), with the contents of a file. Does nothing, successfully, if
+  // the file is missing.
+  bool put_file(submission_record &record, const std::string &name,
+                const std::filesystem::path &file, bool force_blob = false);
+  // Resolved value of the field; empty if absent.
+  std::string get(const submission_record &record,
+                  const std::string &name) const;
+  // Blob file holding the field; empty if the field is inline or absent.
+  std::filesystem::path blob_file(const submission_record &record,
+                                  const std::string &name) const;
+  // Writes the resolved field to a file, e.g. to materialize a binary.
+  bool extract(const submission_record &record, const std::string &name,
+               const std::filesystem::path &file) const;
+
+  std::filesystem::path record_path(const std::string &task,
+                                    const std::string &submission_id) const;
+  bool has_record(const std::string &task,
+                  const std::string &submission_id) const;
+  bool read_record(const std::string &task, const std::string &submission_id,
+                   submission_record &record) const;
+  bool write_record(const std::string &task, const std::string &submission_id,
+                    const submission_record &record);
+
+  std::filesystem::path root;
+  // put_blob() calls that found the content already stored, and that wrote it.
+  std::atomic<uint64_t> blob_hits{0};
+  std::atomic<uint64_t> blob_misses{0};
+};
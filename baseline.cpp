@@ -0,0 +1,295 @@
+#include "pipeline.hpp"
+#include "validation.hpp"
+
+#define CXXOPTS_NO_REGEX true
+#include <cxxopts.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sched.h>
+
+// Baseline regression suite: pushes the known kernels under hacks/<task>/
+// through the submission pipeline of their task and checks each against
+// hacks/<task>/expected, one line per kernel:
+//
+//   <file> <outcome> [flags...]
+//
+// The outcome is one of accepted, rejected (by the code or flag validator),
+// compile_failed, incorrect (the benchmark failed), timeout or drift; an
+// accepted kernel whose run is rejected for calibration drift is skipped, and
+// an accepted kernel of a scaling task fails as not_scaled if the harness
+// measured a single thread count although this process may use several cores.
+// The cycles per call of accepted kernels are appended to a history file; a
+// kernel that moves more than --tolerance away from the median of its last
+// --window recorded runs fails the suite. Cycles per call are only comparable
+// on one machine, so give each machine its own history. Run it from the
+// repository root, as it uses runtime/compile.sh. Exits with 1 if any kernel
+// failed.
+
+namespace {
+
+std::string read_text(const std::filesystem::path &path) {
+  std::ifstream f(path.string(), std::ios::binary);
+  std::stringstream buffer;
+  buffer << f.rdbuf();
+  std::string text = buffer.str();
+  while (!text.empty() && text.back() == '\n') {
+    text.pop_back();
+  }
+  return text;
+}
+
+std::vector<std::string> read_lines(const std::filesystem::path &path) {
+  std::vector<std::string> lines;
+  std::ifstream f(path.string());
+  std::string line;
+  while (std::getline(f, line)) {
+    if (!line.empty()) {
+      lines.push_back(line);
+    }
+  }
+  return lines;
+}
+
+// The exit code names used in the expected files.
+std::string outcome_name(int exit_code) {
+  switch (exit_code) {
+    case 0: return "accepted";
+    case 1: return "compile_failed";
+    case 2: return "incorrect";
+    case 4: return "timeout";
+    case 5: return "drift";
+  }
+  return "exit_" + std::to_string(exit_code);
+}
+
+struct baseline_kernel {
+  std::string task;
+  std::string file;
+  std::string expected;
+  std::string flags;
+};
+
+std::vector<baseline_kernel> load_kernels(const std::filesystem::path &hacks) {
+  std::vector<baseline_kernel> kernels;
+  if (!std::filesystem::is_directory(hacks)) {
+    return kernels;
+  }
+  std::vector<std::filesystem::path> folders;
+  for (const auto &entry : std::filesystem::directory_iterator(hacks)) {
+    if (std::filesystem::exists(entry.path() / "expected")) {
+      folders.push_back(entry.path());
+    }
+  }
+  std::sort(folders.begin(), folders.end());
+  for (const std::filesystem::path &folder : folders) {
+    for (const std::string &line : read_lines(folder / "expected")) {
+      std::stringstream ss(line);
+      baseline_kernel k;
+      k.task = folder.filename().string();
+      ss >> k.file >> k.expected;
+      std::getline(ss >> std::ws, k.flags);
+      if (k.file.empty() || k.file[0] == '#') {
+        continue;
+      }
+      kernels.push_back(k);
+    }
+  }
+  return kernels;
+}
+
+// Cycles per call of the accepted runs recorded so far, oldest first, keyed by
+// "<task>/<file>". Lines are "<unix time> <task> <file> <cycles/call> <label>".
+std::map<std::string, std::vector<double>> load_history(
+    const std::filesystem::path &path) {
+  std::map<std::string, std::vector<double>> history;
+  for (const std::string &line : read_lines(path)) {
+    std::stringstream ss(line);
+    long long time;
+    std::string task, file;
+    double cycles;
+    if (ss >> time >> task >> file >> cycles) {
+      history[task + "/" + file].push_back(cycles);
+    }
+  }
+  return history;
+}
+
+double median_of_last(std::vector<double> values, size_t window) {
+  if (values.size() > window) {
+    values.erase(values.begin(), values.end() - window);
+  }
+  std::sort(values.begin(), values.end());
+  size_t n = values.size();
+  return n % 2 ? values[n / 2] : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+}
+
+// Cores this process may run on, which the scaling harness should see too.
+int allowed_cpus() {
+  cpu_set_t set;
+  return sched_getaffinity(0, sizeof(set), &set) == 0 ? CPU_COUNT(&set) : 1;
+}
+
+// Thread counts in the "scaling <threads> ..." lines of a scaling harness.
+int scaling_points(const std::string &timing) {
+  std::stringstream ss(timing);
+  std::string line;
+  int points = 0;
+  while (std::getline(ss, line)) {
+    points += line.compare(0, 8, "scaling ") == 0;
+  }
+  return points;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  // clang-format off
+  cxxopts::Options options("ClassroomPerfBaseline", "Runs the reference kernels in hacks/ through the submission pipeline");
+  options.add_options()
+    ("hacks-dir", "Directory with one folder of kernels per task.", cxxopts::value<std::string>()->default_value("hacks"))
+    ("tasks-dir", "Directory with the task definitions.", cxxopts::value<std::string>()->default_value("tasks"))
+    ("work-dir", "Directory kernels are compiled and run in.", cxxopts::value<std::string>()->default_value("work/baseline"))
+    ("history", "File the cycles per call of accepted kernels are appended to.", cxxopts::value<std::string>()->default_value("hacks/history.txt"))
+    ("tolerance", "Relative change of cycles per call against the baseline that fails a kernel.", cxxopts::value<double>()->default_value("0.15"))
+    ("window", "Number of recorded runs the baseline is the median of.", cxxopts::value<int>()->default_value("5"))
+    ("update", "Record the results even if they move beyond the tolerance, starting a new baseline.")
+    ("label", "Label stored with the results, e.g. the git revision.", cxxopts::value<std::string>()->default_value("-"))
+    ("benchmark-attempts", "Maximum benchmark runs when runs are noisy.", cxxopts::value<int>()->default_value("3"))
+    ("max-calibration-drift", "Relative calibration change across a run above which it is rejected.", cxxopts::value<double>()->default_value("0.05"))
+    ("benchmark-core", "Pin benchmarks to this core (-1: no pinning).", cxxopts::value<int>()->default_value("-1"))
+    ("h,help", "Print usage.")
+    ;
+  // clang-format on
+
+  auto args = options.parse(argc, argv);
+  if (args.count("help")) {
+    std::cout << options.help() << std::endl;
+    std::exit(0);
+  }
+
+  benchmark_policy settings;
+  settings.max_attempts = args["benchmark-attempts"].as<int>();
+  settings.max_calibration_drift = args["max-calibration-drift"].as<double>();
+  settings.cpu = args["benchmark-core"].as<int>();
+
+  std::filesystem::path hacks_dir = args["hacks-dir"].as<std::string>();
+  std::filesystem::path tasks_dir = args["tasks-dir"].as<std::string>();
+  std::filesystem::path work_root = args["work-dir"].as<std::string>();
+  std::filesystem::path history_file = args["history"].as<std::string>();
+  double tolerance = args["tolerance"].as<double>();
+  size_t window = std::max(1, args["window"].as<int>());
+  bool update = args.count("update") > 0;
+  std::string label = args["label"].as<std::string>();
+
+  std::vector<baseline_kernel> kernels = load_kernels(hacks_dir);
+  if (kernels.empty()) {
+    std::printf("No kernels with an expected file found.\n");
+    return 1;
+  }
+  std::map<std::string, std::vector<double>> history =
+      load_history(history_file);
+
+  std::vector<std::string> report;
+  std::vector<std::string> recorded;
+  int failures = 0;
+  int skipped = 0;
+  for (const baseline_kernel &k : kernels) {
+    std::filesystem::path task_folder = tasks_dir / k.task;
+    std::filesystem::path source = hacks_dir / k.task / k.file;
+    std::string key = k.task + "/" + k.file;
+    std::printf("Baseline %s (%s).\n", key.c_str(), k.flags.c_str());
+
+    pipeline_job job;
+    job.task = k.task;
+    job.submission_id = "baseline-" + source.stem().string();
+    job.code = read_text(source);
+    job.flags = k.flags;
+    job.task_flags = read_text(task_folder / "compile_flags");
+    job.symbol = read_text(task_folder / "symbol");
+    job.benchmark_source = read_text(task_folder / "benchmark.cpp");
+    job.multi_core = read_text(task_folder / "mode") == "scaling";
+    job.dataset = read_text(task_folder / "dataset");
+
+    std::string outcome;
+    double cycles = 0;
+    if (job.symbol.empty() || job.code.empty()) {
+      outcome = "missing";
+    } else if (!validate_code_input(job.code,
+                                    read_lines(task_folder / "bad_code.regex")) ||
+               !validate_flags(job.flags)) {
+      outcome = "rejected";
+    } else {
+      submission_record output = run_pipeline(job, settings, work_root);
+      outcome = outcome_name(
+          std::atoi(inline_field(output, "exit_code").c_str()));
+      double best_time = 0;
+      std::string timing = inline_field(output, "best_time.txt");
+      std::stringstream(timing) >> best_time >> cycles;
+      if (outcome == "accepted" && job.multi_core && allowed_cpus() > 1 &&
+          scaling_points(timing) < 2) {
+        outcome = "not_scaled";
+      }
+    }
+
+    char line[512];
+    if (outcome == "drift" && k.expected == "accepted") {
+      // The machine, not the kernel, changed during the run.
+      std::snprintf(line, sizeof(line), "skip %-32s calibration drift",
+                    key.c_str());
+      skipped++;
+    } else if (outcome != k.expected) {
+      std::snprintf(line, sizeof(line), "FAIL %-32s %s, expected %s",
+                    key.c_str(), outcome.c_str(), k.expected.c_str());
+      failures++;
+    } else if (outcome != "accepted") {
+      std::snprintf(line, sizeof(line), "ok   %-32s %s", key.c_str(),
+                    outcome.c_str());
+    } else if (history[key].empty()) {
+      std::snprintf(line, sizeof(line),
+                    "ok   %-32s %.3f cycles/call (no baseline yet)",
+                    key.c_str(), cycles);
+      recorded.push_back(k.task + " " + k.file + " " + std::to_string(cycles));
+    } else {
+      double baseline = median_of_last(history[key], window);
+      double change = cycles / baseline - 1;
+      bool shifted = !(std::abs(change) <= tolerance);
+      std::snprintf(line, sizeof(line),
+                    "%s %-32s %.3f cycles/call, baseline %.3f (%+.1f%%)",
+                    shifted ? (update ? "NEW " : "FAIL") : "ok  ", key.c_str(),
+                    cycles, baseline, change * 100);
+      if (shifted && !update) {
+        failures++;
+      } else {
+        recorded.push_back(k.task + " " + k.file + " " + std::to_string(cycles));
+      }
+    }
+    report.push_back(line);
+  }
+
+  if (!recorded.empty()) {
+    std::ofstream out(history_file.string(), std::ios::app);
+    std::time_t now = std::time(nullptr);
+    for (const std::string &entry : recorded) {
+      out << now << " " << entry << " " << label << "\n";
+    }
+  }
+
+  std::printf("\nBaseline results (tolerance %.0f%%):\n", tolerance * 100);
+  for (const std::string &line : report) {
+    std::printf("%s\n", line.c_str());
+  }
+  std::printf("%zu kernels, %d failed, %d skipped.\n", kernels.size(), failures,
+              skipped);
+  return failures ? 1 : 0;
+}
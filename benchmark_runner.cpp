@@ -0,0 +1,373 @@
+#include "benchmark_runner.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+double seconds(const timeval &tv) { return tv.tv_sec + tv.tv_usec * 1e-6; }
+
+// Waits for the child until the deadline. Uses a pidfd when the kernel has one
+// so the server does not wake up periodically next to the benchmark.
+bool wait_for_exit(pid_t pid, double timeout_seconds) {
+#ifdef SYS_pidfd_open
+  int pidfd = syscall(SYS_pidfd_open, pid, 0);
+  if (pidfd >= 0) {
+    pollfd pfd{pidfd, POLLIN, 0};
+    int ready = poll(&pfd, 1, int(timeout_seconds * 1000));
+    close(pidfd);
+    return ready > 0;
+  }
+#endif
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::duration<double>(timeout_seconds);
+  while (std::chrono::steady_clock::now() < deadline) {
+    siginfo_t info{};
+    if (waitid(P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) == 0 &&
+        info.si_pid == pid) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  }
+  return false;
+}
+
+template <typename F>
+double best_of(int repetitions, F &&f) {
+  double best = std::numeric_limits<double>::max();
+  for (int i = 0; i < repetitions; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto stop = std::chrono::steady_clock::now();
+    best = std::min(best, std::chrono::duration<double>(stop - start).count());
+  }
+  return best;
+}
+
+volatile double calibration_sink;
+
+// Pins the calling thread to one core for its lifetime, so the calibration
+// measures the same core the benchmark runs on.
+struct scoped_thread_affinity {
+  explicit scoped_thread_affinity(int cpu) {
+    if (cpu < 0) {
+      return;
+    }
+    pinned = pthread_getaffinity_np(pthread_self(), sizeof(previous),
+                                    &previous) == 0;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pinned = pinned &&
+             pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+  }
+  ~scoped_thread_affinity() {
+    if (pinned) {
+      pthread_setaffinity_np(pthread_self(), sizeof(previous), &previous);
+    }
+  }
+
+  bool pinned{false};
+  cpu_set_t previous;
+};
+
+}  // namespace
+
+calibration_sample run_calibration() {
+  constexpr int chain_length = 1 << 23;
+  constexpr size_t stream_size = size_t(32) << 20;  // bytes
+  static std::vector<double> stream_buffer(stream_size / sizeof(double), 1.0);
+
+  calibration_sample sample;
+  sample.compute_seconds = best_of(3, []() {
+    double x = calibration_sink;
+    double a = 0.999999, b = 1e-7;
+    for (int i = 0; i < chain_length; ++i) {
+      x = x * a + b;
+    }
+    calibration_sink = x;
+  });
+  sample.stream_seconds = best_of(3, []() {
+    double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    const double *data = stream_buffer.data();
+    for (size_t i = 0; i < stream_buffer.size(); i += 4) {
+      s0 += data[i];
+      s1 += data[i + 1];
+      s2 += data[i + 2];
+      s3 += data[i + 3];
+    }
+    calibration_sink = s0 + s1 + s2 + s3;
+  });
+  return sample;
+}
+
+calibration_sample run_calibration(int cpu) {
+  scoped_thread_affinity affinity(cpu);
+  return run_calibration();
+}
+
+double calibration_pair::drift() const {
+  double lo = std::min(before.total(), after.total());
+  double hi = std::max(before.total(), after.total());
+  return lo > 0 ? (hi - lo) / lo : 0;
+}
+
+std::string calibration_pair::to_text() const {
+  std::stringstream ss;
+  ss << std::setprecision(9);
+  ss << "before_compute " << before.compute_seconds << "\n";
+  ss << "before_stream " << before.stream_seconds << "\n";
+  ss << "after_compute " << after.compute_seconds << "\n";
+  ss << "after_stream " << after.stream_seconds << "\n";
+  return ss.str();
+}
+
+calibration_pair calibration_pair::from_text(const std::string &text) {
+  calibration_pair c;
+  std::stringstream ss(text);
+  std::string key;
+  while (ss >> key) {
+    if (key == "before_compute") ss >> c.before.compute_seconds;
+    else if (key == "before_stream") ss >> c.before.stream_seconds;
+    else if (key == "after_compute") ss >> c.after.compute_seconds;
+    else if (key == "after_stream") ss >> c.after.stream_seconds;
+    else ss >> key;  // skip unknown value
+  }
+  return c;
+}
+
+std::string benchmark_usage::to_text() const {
+  std::stringstream ss;
+  ss << "wall_time " << wall_time << "\n";
+  ss << "user_time " << user_time << "\n";
+  ss << "system_time " << system_time << "\n";
+  ss << "max_rss_kb " << max_rss_kb << "\n";
+  ss << "voluntary_switches " << voluntary_switches << "\n";
+  ss << "involuntary_switches " << involuntary_switches << "\n";
+  ss << "major_faults " << major_faults << "\n";
+  ss << "minor_faults " << minor_faults << "\n";
+  ss << "attempts " << attempts << "\n";
+  ss << "noisy " << noisy << "\n";
+  return ss.str();
+}
+
+benchmark_usage benchmark_usage::from_text(const std::string &text) {
+  benchmark_usage u;
+  std::stringstream ss(text);
+  std::string key;
+  while (ss >> key) {
+    if (key == "wall_time") ss >> u.wall_time;
+    else if (key == "user_time") ss >> u.user_time;
+    else if (key == "system_time") ss >> u.system_time;
+    else if (key == "max_rss_kb") ss >> u.max_rss_kb;
+    else if (key == "voluntary_switches") ss >> u.voluntary_switches;
+    else if (key == "involuntary_switches") ss >> u.involuntary_switches;
+    else if (key == "major_faults") ss >> u.major_faults;
+    else if (key == "minor_faults") ss >> u.minor_faults;
+    else if (key == "attempts") ss >> u.attempts;
+    else if (key == "noisy") ss >> u.noisy;
+    else ss >> key;  // skip unknown value
+  }
+  return u;
+}
+
+bool is_noisy(const benchmark_usage &usage, const benchmark_policy &policy) {
+  if (usage.involuntary_switches > policy.max_involuntary_switches) {
+    return true;
+  }
+  double cpu_time = usage.user_time + usage.system_time;
+  return cpu_time > 0 &&
+         usage.system_time > policy.max_system_time_fraction * cpu_time;
+}
+
+benchmark_run run_benchmark_process(const std::filesystem::path &dir,
+                                    const benchmark_policy &policy) {
+  benchmark_run run;
+  // Everything the child needs is prepared before fork(): only
+  // async-signal-safe calls are allowed in it, as the server is threaded.
+  std::string dir_str = dir.string();
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  bool pin = policy.cpu >= 0 && !policy.multi_core;
+  if (pin) {
+    CPU_SET(policy.cpu, &cpu_set);
+  }
+  auto start = std::chrono::steady_clock::now();
+  pid_t pid = fork();
+  if (pid < 0) {
+    std::perror("fork");
+    return run;
+  }
+  if (pid == 0) {
+    if (pin) {
+      sched_setaffinity(0, sizeof(cpu_set), &cpu_set);
+    }
+    if (chdir(dir_str.c_str()) != 0) {
+      _exit(127);
+    }
+    int out = open("best_time.txt", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    int err = open("benchmark_output", O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0 || err < 0) {
+      _exit(127);
+    }
+    dup2(out, STDOUT_FILENO);
+    dup2(err, STDERR_FILENO);
+    execl("./benchmark", "./benchmark", (char *)nullptr);
+    _exit(127);
+  }
+
+  bool exited = wait_for_exit(pid, policy.timeout_seconds);
+  if (!exited) {
+    kill(pid, SIGKILL);
+  }
+  int wstatus = 0;
+  rusage ru{};
+  while (wait4(pid, &wstatus, 0, &ru) < 0 && errno == EINTR) {
+  }
+  auto stop = std::chrono::steady_clock::now();
+
+  run.usage.wall_time = std::chrono::duration<double>(stop - start).count();
+  run.usage.user_time = seconds(ru.ru_utime);
+  run.usage.system_time = seconds(ru.ru_stime);
+  run.usage.max_rss_kb = ru.ru_maxrss;
+  run.usage.voluntary_switches = ru.ru_nvcsw;
+  run.usage.involuntary_switches = ru.ru_nivcsw;
+  run.usage.major_faults = ru.ru_majflt;
+  run.usage.minor_faults = ru.ru_minflt;
+  run.usage.attempts = 1;
+  run.usage.noisy = is_noisy(run.usage, policy);
+
+  if (!exited) {
+    std::printf("Timeout\n");
+    run.status = 4;
+  } else if (WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0) {
+    run.status = 0;
+  } else {
+    std::printf("Benchmark unhappy (status %d)\n", wstatus);
+    run.status = 2;
+  }
+  return run;
+}
+
+namespace {
+
+struct machine_state {
+  std::mutex mutex;
+  std::condition_variable cv;
+  int shared{0};
+  int waiting_exclusive{0};
+  bool exclusive{false};
+};
+
+machine_state &machine() {
+  static machine_state state;
+  return state;
+}
+
+}  // namespace
+
+machine_lock::machine_lock(mode m) : held(m) {
+  machine_state &state = machine();
+  std::unique_lock<std::mutex> lock(state.mutex);
+  if (m == mode::shared) {
+    state.cv.wait(lock, [&]() {
+      return !state.exclusive && state.waiting_exclusive == 0;
+    });
+    state.shared++;
+  } else if (m == mode::exclusive) {
+    state.waiting_exclusive++;
+    state.cv.wait(lock,
+                  [&]() { return !state.exclusive && state.shared == 0; });
+    state.waiting_exclusive--;
+    state.exclusive = true;
+  }
+}
+
+machine_lock &machine_lock::operator=(machine_lock &&other) {
+  if (this != &other) {
+    unlock();
+    held = std::exchange(other.held, mode::none);
+  }
+  return *this;
+}
+
+void machine_lock::unlock() {
+  if (held == mode::none) {
+    return;
+  }
+  machine_state &state = machine();
+  {
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (held == mode::shared) {
+      state.shared--;
+    } else {
+      state.exclusive = false;
+    }
+  }
+  held = mode::none;
+  state.cv.notify_all();
+}
+
+benchmark_core_lock lock_benchmark_core(const benchmark_policy &policy) {
+  static std::mutex core_mutex;
+  benchmark_core_lock lock;
+  lock.machine = machine_lock(policy.multi_core ? machine_lock::mode::exclusive
+                                                : machine_lock::mode::shared);
+  if (policy.cpu >= 0 && !policy.multi_core) {
+    lock.core = std::unique_lock<std::mutex>(core_mutex);
+  }
+  return lock;
+}
+
+benchmark_run run_benchmark(const std::filesystem::path &dir,
+                            const benchmark_policy &policy) {
+  benchmark_core_lock core_lock = lock_benchmark_core(policy);
+  // The child inherits this thread's mask, and a multi-core harness spreads
+  // over every core it is allowed on.
+  scoped_thread_affinity affinity(policy.multi_core ? -1 : policy.cpu);
+  benchmark_run run;
+  for (int attempt = 1; attempt <= std::max(1, policy.max_attempts);
+       ++attempt) {
+    calibration_sample before = run_calibration();
+    run = run_benchmark_process(dir, policy);
+    run.calibration.before = before;
+    run.calibration.after = run_calibration();
+    run.usage.attempts = attempt;
+    bool drifting = run.calibration.drift() > policy.max_calibration_drift;
+    std::printf("Benchmark attempt %d: status %d, %ld involuntary switches, "
+                "%.3fs user, %.3fs system, calibration drift %.2f%%%s%s\n",
+                attempt, run.status, run.usage.involuntary_switches,
+                run.usage.user_time, run.usage.system_time,
+                run.calibration.drift() * 100, run.usage.noisy ? " (noisy)" : "",
+                drifting ? " (drifting)" : "");
+    if (run.status != 0) {
+      break;
+    }
+    if (!run.usage.noisy && !drifting) {
+      break;
+    }
+    if (drifting && attempt == std::max(1, policy.max_attempts)) {
+      std::printf("Calibration drift too large, rejecting run.\n");
+      run.status = 5;
+    }
+  }
+  return run;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <utility>
+
+// Resource usage of one benchmark process, as reported by wait4().
+struct benchmark_usage {
+  double wall_time{0};    // seconds
+  double user_time{0};    // seconds
+  double system_time{0};  // seconds
+  long max_rss_kb{0};
+  long voluntary_switches{0};
+  long involuntary_switches{0};
+  long major_faults{0};
+  long minor_faults{0};
+  int attempts{0};
+  bool noisy{false};
+
+  // "key value" lines, as stored in the submission record.
+  std::string to_text() const;
+  static benchmark_usage from_text(const std::string &text);
+};
+
+// Timing of the fixed machine calibration kernel: a dependent multiply-add
+// chain (core clock) and a streaming sum over a buffer larger than the caches
+// (memory bandwidth). Lower is faster.
+struct calibration_sample {
+  double compute_seconds{0};
+  double stream_seconds{0};
+
+  double total() const { return compute_seconds + stream_seconds; }
+};
+
+calibration_sample run_calibration();
+// Runs the calibration with the calling thread pinned to the given core, as
+// run_benchmark() does for its calibrations. -1 leaves placement to the
+// scheduler.
+calibration_sample run_calibration(int cpu);
+
+// Measurements taken around one benchmark run.
+struct calibration_pair {
+  calibration_sample before;
+  calibration_sample after;
+
+  double mean() const { return 0.5 * (before.total() + after.total()); }
+  // Relative disagreement between both measurements.
+  double drift() const;
+
+  std::string to_text() const;
+  static calibration_pair from_text(const std::string &text);
+};
+
+// When a run counts as disturbed, and how often it is retried.
+struct benchmark_policy {
+  double timeout_seconds{8.0};
+  // Limit on compiling a submission, see run_pipeline().
+  double compile_timeout_seconds{60.0};
+  long max_involuntary_switches{10};
+  double max_system_time_fraction{0.05};
+  double max_calibration_drift{0.05};
+  int max_attempts{3};
+  // Core the benchmark and its calibration are pinned to; -1 leaves placement
+  // to the scheduler. Runs on a pinned core never overlap.
+  int cpu{-1};
+  // The benchmark spreads its own threads over the machine: it is not pinned,
+  // and takes the whole machine, see lock_benchmark_core().
+  bool multi_core{false};
+};
+
+bool is_noisy(const benchmark_usage &usage, const benchmark_policy &policy);
+
+struct benchmark_run {
+  // Same codes as the submission exit_code: 0 ok, 2 benchmark failed,
+  // 4 timeout, 5 rejected because the machine drifted during the run.
+  int status{2};
+  benchmark_usage usage;
+  calibration_pair calibration;
+};
+
+// Runs <dir>/benchmark with <dir> as working directory, writing stdout to
+// best_time.txt and stderr to benchmark_output. The process is killed when it
+// exceeds the policy timeout. The caller must hold the lock from
+// lock_benchmark_core().
+benchmark_run run_benchmark_process(const std::filesystem::path &dir,
+                                    const benchmark_policy &policy);
+
+// Use of the whole machine by the pipeline in this process. Compiles and
+// single-core benchmarks share it; a multi-core benchmark needs it to itself,
+// whatever core the others are pinned to. A waiting exclusive user blocks new
+// shared ones, so multi-core runs are not starved by a stream of compiles.
+class machine_lock {
+ public:
+  enum class mode { none, shared, exclusive };
+
+  machine_lock() = default;
+  explicit machine_lock(mode m);
+  machine_lock(machine_lock &&other) : held(std::exchange(other.held, mode::none)) {}
+  machine_lock &operator=(machine_lock &&other);
+  machine_lock(const machine_lock &) = delete;
+  machine_lock &operator=(const machine_lock &) = delete;
+  ~machine_lock() { unlock(); }
+
+  void unlock();
+
+ private:
+  mode held{mode::none};
+};
+
+// Held around one benchmark run (with its calibration).
+struct benchmark_core_lock {
+  machine_lock machine;
+  std::unique_lock<std::mutex> core;  // unlocked if the policy pins no core
+
+  void unlock() {
+    if (core.owns_lock()) {
+      core.unlock();
+    }
+    machine.unlock();
+  }
+};
+
+// Serializes runs on the pinned benchmark core, and gives multi-core runs the
+// machine to themselves.
+benchmark_core_lock lock_benchmark_core(const benchmark_policy &policy);
+
+// Runs the benchmark between two calibrations until a run is neither noisy
+// nor drifting, up to policy.max_attempts times. The usage of the returned
+// run records the number of attempts. If the last run still drifts beyond
+// policy.max_calibration_drift, its status is 5.
+benchmark_run run_benchmark(const std::filesystem::path &dir,
+                            const benchmark_policy &policy);
@@ -0,0 +1,265 @@
+#include "compare.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <tuple>
+
+std::vector<double> parse_timing_samples(const std::string &benchmark_output) {
+  std::vector<double> samples;
+  std::stringstream ss(benchmark_output);
+  std::string line;
+  while (std::getline(ss, line)) {
+    if (line.compare(0, 6, "Time: ") == 0) {
+      samples.push_back(std::atof(line.c_str() + 6));
+    }
+  }
+  return samples;
+}
+
+namespace {
+
+double median_of_sorted(const std::vector<double> &sorted) {
+  size_t n = sorted.size();
+  if (n == 0) {
+    return 0;
+  }
+  return n % 2 ? sorted[n / 2] : 0.5 * (sorted[n / 2 - 1] + sorted[n / 2]);
+}
+
+double median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  return median_of_sorted(values);
+}
+
+// Returns U of a and the two-sided p-value.
+std::pair<double, double> mann_whitney(const std::vector<double> &a,
+                                       const std::vector<double> &b) {
+  size_t na = a.size(), nb = b.size(), n = na + nb;
+  if (na == 0 || nb == 0) {
+    return {0, 1};
+  }
+  std::vector<std::pair<double, bool>> all;  // value, from a
+  for (double v : a) all.push_back({v, true});
+  for (double v : b) all.push_back({v, false});
+  std::sort(all.begin(), all.end());
+
+  double rank_sum_a = 0;
+  double tie_term = 0;
+  for (size_t i = 0; i < n;) {
+    size_t j = i;
+    while (j < n && all[j].first == all[i].first) {
+      ++j;
+    }
+    double rank = 0.5 * (i + 1 + j);  // average of ranks i+1..j
+    for (size_t k = i; k < j; ++k) {
+      if (all[k].second) {
+        rank_sum_a += rank;
+      }
+    }
+    double t = j - i;
+    tie_term += t * t * t - t;
+    i = j;
+  }
+  double u = rank_sum_a - na * (na + 1) / 2.0;
+  double mu = na * nb / 2.0;
+  double sigma = std::sqrt(na * nb / 12.0 *
+                           ((n + 1) - tie_term / (double(n) * (n - 1))));
+  if (sigma == 0) {
+    return {u, 1};
+  }
+  double z = (std::abs(u - mu) - 0.5) / sigma;
+  return {u, std::erfc(std::max(0.0, z) / std::sqrt(2.0))};
+}
+
+}  // namespace
+
+sample_summary summarize(std::vector<double> samples) {
+  sample_summary s;
+  s.count = samples.size();
+  if (samples.empty()) {
+    return s;
+  }
+  std::sort(samples.begin(), samples.end());
+  s.min = samples.front();
+  s.median = median_of_sorted(samples);
+  for (double v : samples) {
+    s.mean += v;
+  }
+  s.mean /= samples.size();
+  for (double v : samples) {
+    s.stddev += (v - s.mean) * (v - s.mean);
+  }
+  s.stddev = samples.size() > 1 ? std::sqrt(s.stddev / (samples.size() - 1))
+                                : 0;
+  return s;
+}
+
+sample_comparison compare_samples(const std::vector<double> &a,
+                                  const std::vector<double> &b,
+                                  int bootstrap_iterations) {
+  sample_comparison c;
+  c.a = summarize(a);
+  c.b = summarize(b);
+  if (a.empty() || b.empty() || c.b.median == 0) {
+    return c;
+  }
+  c.speedup = c.a.median / c.b.median;
+  std::tie(c.u, c.p_value) = mann_whitney(a, b);
+
+  // Fixed seed: reloading the page gives the same interval.
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<size_t> pick_a(0, a.size() - 1);
+  std::uniform_int_distribution<size_t> pick_b(0, b.size() - 1);
+  std::vector<double> ratios;
+  std::vector<double> ra(a.size()), rb(b.size());
+  ratios.reserve(bootstrap_iterations);
+  for (int i = 0; i < bootstrap_iterations; ++i) {
+    for (double &v : ra) v = a[pick_a(rng)];
+    for (double &v : rb) v = b[pick_b(rng)];
+    double mb = median(rb);
+    if (mb > 0) {
+      ratios.push_back(median(ra) / mb);
+    }
+  }
+  if (!ratios.empty()) {
+    std::sort(ratios.begin(), ratios.end());
+    c.speedup_low = ratios[size_t(0.025 * (ratios.size() - 1))];
+    c.speedup_high = ratios[size_t(0.975 * (ratios.size() - 1))];
+  }
+  return c;
+}
+
+std::string strip_html(const std::string &html) {
+  std::string out;
+  out.reserve(html.size());
+  for (size_t i = 0; i < html.size(); ++i) {
+    char ch = html[i];
+    if (ch == '<') {
+      size_t end = html.find('>', i);
+      if (end == std::string::npos) {
+        break;
+      }
+      i = end;
+    } else if (ch == '&') {
+      static const std::pair<const char *, char> entities[] = {
+          {"&lt;", '<'}, {"&gt;", '>'}, {"&amp;", '&'},
+          {"&quot;", '"'}, {"&#39;", '\''}, {"&apos;", '\''}};
+      bool decoded = false;
+      for (const auto &[name, value] : entities) {
+        size_t len = std::char_traits<char>::length(name);
+        if (html.compare(i, len, name) == 0) {
+          out += value;
+          i += len - 1;
+          decoded = true;
+          break;
+        }
+      }
+      if (!decoded) {
+        out += ch;
+      }
+    } else {
+      out += ch;
+    }
+  }
+  return out;
+}
+
+std::vector<basic_block> split_basic_blocks(const std::string &disassembly) {
+  std::vector<basic_block> blocks;
+  basic_block current;
+  auto flush = [&]() {
+    if (!current.lines.empty()) {
+      blocks.push_back(std::move(current));
+    }
+    current = basic_block();
+  };
+
+  std::stringstream ss(disassembly);
+  std::string line;
+  while (std::getline(ss, line)) {
+    // Instruction lines start with a tab, followed by the jump art.
+    if (line.empty() || line[0] != '\t') {
+      continue;
+    }
+    size_t start = line.find_first_not_of(" \t/\\|->");
+    if (start == std::string::npos) {
+      continue;
+    }
+    std::string art = line.substr(1, start - 1);
+    std::string insn = line.substr(start);
+    size_t art_end = art.find_last_not_of(' ');
+    bool jump_target = art_end != std::string::npos && art[art_end] == '>';
+    if (jump_target) {
+      flush();
+    }
+
+    // Jump targets are printed as <symbol+offset>; the offsets differ as soon
+    // as one instruction changes, so they are left out of the block key.
+    std::string key = insn;
+    size_t lt;
+    while ((lt = key.find('<')) != std::string::npos) {
+      size_t gt = key.find('>', lt);
+      if (gt == std::string::npos) {
+        break;
+      }
+      key.replace(lt, gt - lt + 1, "@");
+    }
+    current.lines.push_back(insn);
+    current.key += key + "\n";
+
+    std::string mnemonic = insn.substr(0, insn.find(' '));
+    if (mnemonic[0] == 'j' || mnemonic.compare(0, 3, "ret") == 0 ||
+        mnemonic == "ud2") {
+      flush();
+    }
+  }
+  flush();
+  return blocks;
+}
+
+std::vector<std::pair<int, int>> align_basic_blocks(
+    const std::vector<basic_block> &a, const std::vector<basic_block> &b) {
+  size_t n = a.size(), m = b.size();
+  // lcs[i][j]: length of the LCS of a[i..] and b[j..]
+  std::vector<std::vector<int>> lcs(n + 1, std::vector<int>(m + 1, 0));
+  for (size_t i = n; i-- > 0;) {
+    for (size_t j = m; j-- > 0;) {
+      lcs[i][j] = a[i].key == b[j].key
+                      ? lcs[i + 1][j + 1] + 1
+                      : std::max(lcs[i + 1][j], lcs[i][j + 1]);
+    }
+  }
+
+  std::vector<std::pair<int, int>> pairs;
+  std::vector<int> pending_a, pending_b;
+  auto flush = [&]() {
+    size_t k = 0;
+    for (; k < pending_a.size() && k < pending_b.size(); ++k) {
+      pairs.push_back({pending_a[k], pending_b[k]});
+    }
+    for (size_t i = k; i < pending_a.size(); ++i) {
+      pairs.push_back({pending_a[i], -1});
+    }
+    for (size_t j = k; j < pending_b.size(); ++j) {
+      pairs.push_back({-1, pending_b[j]});
+    }
+    pending_a.clear();
+    pending_b.clear();
+  };
+  size_t i = 0, j = 0;
+  while (i < n || j < m) {
+    if (i < n && j < m && a[i].key == b[j].key) {
+      flush();
+      pairs.push_back({int(i++), int(j++)});
+    } else if (j == m || (i < n && lcs[i + 1][j] >= lcs[i][j + 1])) {
+      pending_a.push_back(i++);
+    } else {
+      pending_b.push_back(j++);
+    }
+  }
+  flush();
+  return pairs;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+// Per-run times ("Time: <seconds>" lines) the benchmark writes to stderr.
+std::vector<double> parse_timing_samples(const std::string &benchmark_output);
+
+struct sample_summary {
+  size_t count{0};
+  double min{0};
+  double median{0};
+  double mean{0};
+  double stddev{0};
+};
+
+sample_summary summarize(std::vector<double> samples);
+
+// Statistical comparison of two timing distributions a and b.
+struct sample_comparison {
+  sample_summary a;
+  sample_summary b;
+  // median(a) / median(b): above 1 means b is faster.
+  double speedup{1};
+  // 95% bootstrap confidence interval of the speedup.
+  double speedup_low{1};
+  double speedup_high{1};
+  // Two-sided Mann-Whitney U test (normal approximation with tie correction).
+  double u{0};
+  double p_value{1};
+
+  bool significant(double alpha = 0.05) const {
+    return p_value < alpha && (speedup_low > 1 || speedup_high < 1);
+  }
+};
+
+sample_comparison compare_samples(const std::vector<double> &a,
+                                  const std::vector<double> &b,
+                                  int bootstrap_iterations = 2000);
+
+// Removes the markup aha puts around the objdump output.
+std::string strip_html(const std::string &html);
+
+// Straight-line run of instructions. A block ends after a jump or return and
+// starts at every jump target, as marked by the --visualize-jumps arrows.
+struct basic_block {
+  std::vector<std::string> lines;  // instructions without the jump art
+  std::string key;                 // lines with jump targets normalized
+};
+
+std::vector<basic_block> split_basic_blocks(const std::string &disassembly);
+
+// Aligns two block lists on their longest common subsequence of identical
+// blocks. Unmatched blocks between two matches are paired up in order; the
+// remainder is paired with -1.
+std::vector<std::pair<int, int>> align_basic_blocks(
+    const std::vector<basic_block> &a, const std::vector<basic_block> &b);
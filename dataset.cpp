@@ -0,0 +1,189 @@
+#include "dataset.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <sstream>
+
+#include <unistd.h>
+
+namespace {
+
+constexpr char dataset_magic[] = "CPDSET01";
+constexpr size_t dataset_alignment = 64;
+constexpr size_t column_name_size = 16;
+// Name, type, zero and offset.
+constexpr size_t column_entry_size = column_name_size + 16;
+
+void put_u32(std::string &out, uint32_t v) {
+  out.append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+void put_u64(std::string &out, uint64_t v) {
+  out.append(reinterpret_cast<const char *>(&v), sizeof(v));
+}
+
+uint64_t align_up(uint64_t v) {
+  return (v + dataset_alignment - 1) / dataset_alignment * dataset_alignment;
+}
+
+// splitmix64: unlike the std:: distributions, its output is the same with
+// every standard library.
+struct dataset_random {
+  explicit dataset_random(uint64_t seed) : state(seed) {}
+
+  uint64_t next() {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+  }
+  // Uniform in [lo, hi).
+  double uniform(double lo, double hi) {
+    return lo + (hi - lo) * (next() >> 11) * 0x1.0p-53;
+  }
+
+  uint64_t state;
+};
+
+// Pairs of points on a sphere, as radius, lat1, lon1, lat2, lon2 in radians.
+// The first point is uniform on the sphere. Half of the second points are
+// within about 0.05 radians of the first, the rest are uniform as well, so
+// both short and long distances occur. Radii are in [0.5, 1] rather than in
+// kilometers: results stay of order one, where the absolute error bound of
+// the task is meaningful.
+std::vector<dataset_column> generate_haversine(uint64_t rows, uint64_t seed) {
+  const double pi = std::acos(-1.0);
+  std::vector<dataset_column> columns = {
+      {"radius", {}}, {"lat1", {}}, {"lon1", {}}, {"lat2", {}}, {"lon2", {}}};
+  for (dataset_column &c : columns) {
+    c.values.resize(rows);
+  }
+  dataset_random rng(seed);
+  auto latitude = [&]() { return std::asin(rng.uniform(-1, 1)); };
+  for (uint64_t i = 0; i < rows; ++i) {
+    double lat1 = latitude();
+    double lon1 = rng.uniform(-pi, pi);
+    double lat2, lon2;
+    if (rng.next() & 1) {
+      lat2 = std::clamp(lat1 + rng.uniform(-0.05, 0.05), -pi / 2, pi / 2);
+      lon2 = lon1 + rng.uniform(-0.05, 0.05);
+      lon2 -= lon2 >= pi ? 2 * pi : lon2 < -pi ? -2 * pi : 0;
+    } else {
+      lat2 = latitude();
+      lon2 = rng.uniform(-pi, pi);
+    }
+    columns[0].values[i] = float(rng.uniform(0.5, 1));
+    columns[1].values[i] = float(lat1);
+    columns[2].values[i] = float(lon1);
+    columns[3].values[i] = float(lat2);
+    columns[4].values[i] = float(lon2);
+  }
+  return columns;
+}
+
+}  // namespace
+
+bool write_dataset(const std::filesystem::path &path,
+                   const std::vector<dataset_column> &columns) {
+  uint64_t rows = columns.empty() ? 0 : columns[0].values.size();
+  std::string header(dataset_magic, sizeof(dataset_magic) - 1);
+  put_u32(header, columns.size());
+  put_u32(header, 0);
+  put_u64(header, rows);
+  uint64_t offset = align_up(header.size() + columns.size() * column_entry_size);
+  for (const dataset_column &c : columns) {
+    if (c.values.size() != rows || c.name.size() >= column_name_size) {
+      return false;
+    }
+    std::string name = c.name;
+    name.resize(column_name_size, '\0');
+    header += name;
+    put_u32(header, uint32_t(dataset_type::f32));
+    put_u32(header, 0);
+    put_u64(header, offset);
+    offset = align_up(offset + rows * sizeof(float));
+  }
+
+  std::ofstream out(path.string(), std::ios::binary | std::ios::trunc);
+  out << header;
+  uint64_t position = header.size();
+  for (const dataset_column &c : columns) {
+    out << std::string(align_up(position) - position, '\0');
+    position = align_up(position) + c.values.size() * sizeof(float);
+    out.write(reinterpret_cast<const char *>(c.values.data()),
+              c.values.size() * sizeof(float));
+  }
+  return bool(out);
+}
+
+bool dataset_spec::parse(const std::string &text, dataset_spec &spec) {
+  std::stringstream ss(text);
+  return ss >> spec.generator >> spec.rows >> spec.seed && spec.rows > 0;
+}
+
+std::string dataset_spec::file_name() const {
+  return generator + "-" + std::to_string(rows) + "-" + std::to_string(seed) +
+         ".bin";
+}
+
+std::vector<dataset_column> generate_dataset(const dataset_spec &spec) {
+  if (spec.generator == "haversine") {
+    return generate_haversine(spec.rows, spec.seed);
+  }
+  return {};
+}
+
+std::filesystem::path ensure_dataset(const std::string &spec_text) {
+  dataset_spec spec;
+  if (!dataset_spec::parse(spec_text, spec)) {
+    std::printf("Invalid dataset spec '%s'.\n", spec_text.c_str());
+    return {};
+  }
+  std::filesystem::path path =
+      std::filesystem::absolute("datasets") / spec.file_name();
+  // Concurrent submissions wait for one generation. Other processes sharing
+  // the directory may generate the same file; the rename keeps it whole.
+  static std::mutex mutex;
+  std::lock_guard<std::mutex> lock(mutex);
+  if (std::filesystem::exists(path)) {
+    return path;
+  }
+  std::printf("Generating dataset %s.\n", path.c_str());
+  std::vector<dataset_column> columns = generate_dataset(spec);
+  if (columns.empty()) {
+    std::printf("Unknown dataset generator '%s'.\n", spec.generator.c_str());
+    return {};
+  }
+  std::error_code ec;
+  std::filesystem::create_directories(path.parent_path(), ec);
+  std::filesystem::path tmp =
+      path.string() + ".tmp." + std::to_string(getpid());
+  if (!write_dataset(tmp, columns)) {
+    std::printf("Could not write dataset %s.\n", tmp.c_str());
+    std::filesystem::remove(tmp, ec);
+    return {};
+  }
+  std::filesystem::rename(tmp, path, ec);
+  if (ec) {
+    std::filesystem::remove(tmp, ec);
+    return {};
+  }
+  return path;
+}
+
+bool link_dataset(const std::filesystem::path &dir,
+                  const std::string &spec_text) {
+  if (spec_text.empty()) {
+    return true;
+  }
+  std::filesystem::path path = ensure_dataset(spec_text);
+  if (path.empty()) {
+    return false;
+  }
+  std::error_code ec;
+  std::filesystem::remove(dir / dataset_link_name, ec);
+  std::filesystem::create_symlink(path, dir / dataset_link_name, ec);
+  return !ec;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+// Large task inputs, generated once per machine and mapped read-only by the
+// harness instead of being built at every benchmark start. File layout, all
+// little endian:
+//
+//   "CPDSET01"                      magic
+//   u32 column count, u32 zero
+//   u64 row count
+//   per column: char name[16] (NUL padded), u32 type, u32 zero, u64 offset
+//   column data                     offsets from the start of the file,
+//                                   64-byte aligned
+//
+// Columns are stored one after another (structure of arrays), so a harness
+// streams through each input sequentially.
+
+enum class dataset_type : uint32_t { f32 = 1 };
+
+struct dataset_column {
+  std::string name;
+  std::vector<float> values;
+};
+
+// Writes the columns, which must all have the same length.
+bool write_dataset(const std::filesystem::path &path,
+                   const std::vector<dataset_column> &columns);
+
+// Contents of tasks/<task>/dataset: "<generator> <rows> <seed>".
+struct dataset_spec {
+  std::string generator;
+  uint64_t rows{0};
+  uint64_t seed{0};
+
+  static bool parse(const std::string &text, dataset_spec &spec);
+  // "<generator>-<rows>-<seed>.bin"
+  std::string file_name() const;
+};
+
+// Columns of the spec's generator, or none if the generator is unknown. The
+// output only depends on the spec, so every machine generates the same file.
+std::vector<dataset_column> generate_dataset(const dataset_spec &spec);
+
+// Path of the dataset under datasets/ (relative to the working directory),
+// generated the first time it is needed. Empty if the spec is invalid or the
+// file could not be written.
+std::filesystem::path ensure_dataset(const std::string &spec_text);
+
+// Name the harness opens in its working directory.
+constexpr const char *dataset_link_name = "dataset.bin";
+
+// Links <dir>/dataset.bin to the dataset of the spec. Does nothing for an
+// empty spec; returns false if the dataset is unavailable.
+bool link_dataset(const std::filesystem::path &dir,
+                  const std::string &spec_text);
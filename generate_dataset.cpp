@@ -0,0 +1,38 @@
+#include "dataset.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+// Generates the datasets of the given tasks under datasets/, as the server and
+// the workers otherwise do on first use. Run it from the repository root.
+// Usage: generate_dataset <task>...
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    std::printf("Usage: %s <task>...\n", argv[0]);
+    return 1;
+  }
+  int failures = 0;
+  for (int i = 1; i < argc; ++i) {
+    std::filesystem::path spec_file =
+        std::filesystem::path("tasks") / argv[i] / "dataset";
+    std::ifstream f(spec_file.string());
+    std::stringstream spec;
+    spec << f.rdbuf();
+    if (!f.is_open() || spec.str().empty()) {
+      std::printf("Task %s has no dataset.\n", argv[i]);
+      failures++;
+      continue;
+    }
+    std::filesystem::path path = ensure_dataset(spec.str());
+    if (path.empty()) {
+      failures++;
+      continue;
+    }
+    std::printf("%s: %s (%ju bytes)\n", argv[i], path.c_str(),
+                uintmax_t(std::filesystem::file_size(path)));
+  }
+  return failures ? 1 : 0;
+}
@@ -10,7 +10,7 @@ static float inv[] = {
 };
 
 /* AVX2 8-wide float with LUT */
-float student_atan(float x, float max_error) {
+float student_atan(float x) {
     float xsq = x * x;
     float fl_xpow4 = xsq * xsq;
     float fl_xpow8 = fl_xpow4 * fl_xpow4;
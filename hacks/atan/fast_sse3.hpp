@@ -1,4 +1,3 @@
-#include <immintrin.h>
 inline float hsum_ps_sse3(__m128 v) {
     __m128 shuf = _mm_movehdup_ps(v);        // broadcast elements 3,1 to 2,0
     __m128 sums = _mm_add_ps(v, shuf);
@@ -8,7 +7,7 @@ inline float hsum_ps_sse3(__m128 v) {
 }
 
 /* SSE3 4-wide float */
-float student_atan(float x, float max_error) {
+float student_atan(float x) {
     float xsq = x * x;
     float fl_xpow4 = xsq * xsq;
     float fl_xpow8 = fl_xpow4 * fl_xpow4;
@@ -29,7 +28,7 @@ float student_atan(float x, float max_error) {
         xpow = _mm_mul_ps(xpow, xpow8);
         r = _mm_add_ps(r, l);
         denom = _mm_add_ps(denom, const8);
-    } while (-_mm_cvtss_f32(l) > max_error);
+    } while (-_mm_cvtss_f32(l) > MAX_ERROR);
 
     float rr = hsum_ps_sse3(r);
     return flip ? -rr : rr;
@@ -1,5 +1,5 @@
 /* Works GREAT with -O3 -mavx -ffast-math */
-float student_atan(float x, float max_error) {
+float student_atan(float x) {
   float r = 0.0f;
   float xpow = x;
   for (int i = 0; i < 8; ++i) {
@@ -1,4 +1,4 @@
-inline float student_atan(float x, float max_error) {
+inline float student_atan(float x) {
     static int count = 0;
     if (count++ > 10000) { return 0.0f; }
 
@@ -20,6 +20,6 @@ inline float student_atan(float x, float max_error) {
         denom = denom + 2;
         r += sign ? l : -l;
         sign ^= 1;
-    } while (l > max_error);
+    } while (l > MAX_ERROR);
     return flip ? -r : r;
 }
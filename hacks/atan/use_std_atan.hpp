@@ -1,5 +1,5 @@
 #include <cmath>
 
-inline float student_atan(float x, float max_error) {
+inline float student_atan(float x) {
   return std::atan(x);
 }
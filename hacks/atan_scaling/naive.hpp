@@ -0,0 +1,17 @@
+/* The naive series of the single-call task, over a slice of the input. */
+void student_atan_array(const float *in, float *out, size_t n) {
+  for (size_t j = 0; j < n; ++j) {
+    float x = in[j];
+    float r = 0.0f;
+    float xpow = x;
+    for (int i = 0; i < 8; ++i) {
+      if (i & 1) {
+        r -= xpow / (2 * i + 1);
+      } else {
+        r += xpow / (2 * i + 1);
+      }
+      xpow *= x * x;
+    }
+    out[j] = r;
+  }
+}
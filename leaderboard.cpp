@@ -0,0 +1,76 @@
+#include "leaderboard.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <set>
+
+namespace {
+
+std::vector<leaderboard_entry> inserted(
+    const std::vector<leaderboard_entry> &sorted, const leaderboard_entry &e) {
+  std::vector<leaderboard_entry> result;
+  result.reserve(sorted.size() + 1);
+  auto pos =
+      std::upper_bound(sorted.begin(), sorted.end(), e, leaderboard_order);
+  result.insert(result.end(), sorted.begin(), pos);
+  result.push_back(e);
+  result.insert(result.end(), pos, sorted.end());
+  return result;
+}
+
+}  // namespace
+
+bool leaderboard_order(const leaderboard_entry &a, const leaderboard_entry &b) {
+  if (a.best_time != b.best_time) {
+    return a.best_time < b.best_time;
+  }
+  return a.submission_id < b.submission_id;
+}
+
+void sort_leaderboard(std::vector<leaderboard_entry> &leaderboard) {
+  std::sort(leaderboard.begin(), leaderboard.end(), leaderboard_order);
+}
+
+leaderboard_store::leaderboard_store()
+    : current(std::make_shared<const leaderboard_snapshot>()) {}
+
+leaderboard_store::snapshot_ptr leaderboard_store::snapshot() const {
+  return std::atomic_load(&current);
+}
+
+void leaderboard_store::publish(std::vector<leaderboard_entry> entries) {
+  auto next = std::make_shared<leaderboard_snapshot>();
+  sort_leaderboard(entries);
+  std::set<std::string> users;
+  for (const leaderboard_entry &e : entries) {
+    if (users.insert(e.user_id).second) {
+      next->user_best.push_back(e);
+    }
+  }
+  next->entries = std::move(entries);
+  std::lock_guard<std::mutex> lock(write_mutex);
+  std::atomic_store(&current, snapshot_ptr(std::move(next)));
+}
+
+void leaderboard_store::insert(leaderboard_entry e) {
+  std::lock_guard<std::mutex> lock(write_mutex);
+  snapshot_ptr prev = snapshot();
+  auto next = std::make_shared<leaderboard_snapshot>();
+  next->entries = inserted(prev->entries, e);
+
+  auto previous_best =
+      std::find_if(prev->user_best.begin(), prev->user_best.end(),
+                   [&](const auto &b) { return b.user_id == e.user_id; });
+  if (previous_best == prev->user_best.end()) {
+    next->user_best = inserted(prev->user_best, e);
+  } else if (leaderboard_order(e, *previous_best)) {
+    std::vector<leaderboard_entry> others;
+    others.reserve(prev->user_best.size());
+    others.insert(others.end(), prev->user_best.begin(), previous_best);
+    others.insert(others.end(), previous_best + 1, prev->user_best.end());
+    next->user_best = inserted(others, e);
+  } else {
+    next->user_best = prev->user_best;
+  }
+  std::atomic_store(&current, snapshot_ptr(std::move(next)));
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct leaderboard_entry {
+  std::string task;
+  std::string user_id;
+  std::string submission_id;
+  double best_time;
+  double cycles_per_call;
+  std::string author;
+  double normalized_time{std::numeric_limits<double>::quiet_NaN()};
+};
+
+// Total order on entries (ties broken by submission id), so that an entry's
+// position is well defined for cursor-based pagination.
+bool leaderboard_order(const leaderboard_entry &a, const leaderboard_entry &b);
+
+void sort_leaderboard(std::vector<leaderboard_entry> &leaderboard);
+
+// Immutable view of a leaderboard.
+struct leaderboard_snapshot {
+  std::vector<leaderboard_entry> entries;    // all entries, sorted
+  std::vector<leaderboard_entry> user_best;  // best entry of every user, sorted
+};
+
+// Copy-on-write leaderboard shared between the httplib worker threads.
+// Readers take an immutable snapshot and never wait for a writer building the
+// next one; writers serialize among themselves, build the next sorted vectors
+// and publish them with an atomic shared_ptr swap. Old snapshots die with their
+// last reader. The shared_ptr load and store are not lock-free: libstdc++
+// guards them with a mutex from a small hashed pool, held only for the pointer
+// copy, so readers may briefly contend with each other and with the swap.
+struct leaderboard_store {
+  using snapshot_ptr = std::shared_ptr<const leaderboard_snapshot>;
+
+  leaderboard_store();
+
+  snapshot_ptr snapshot() const;
+  // Replaces all entries.
+  void publish(std::vector<leaderboard_entry> entries);
+  void insert(leaderboard_entry e);
+
+ private:
+  std::mutex write_mutex;
+  snapshot_ptr current;
+};
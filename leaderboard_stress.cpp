@@ -0,0 +1,162 @@
+#include "leaderboard.hpp"
+
+#define CXXOPTS_NO_REGEX true
+#include <cxxopts.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Stress test of leaderboard_store: reader threads take snapshots in a loop
+// and check that each is sorted, has one best entry per user and never shrinks,
+// while writer threads insert entries in bursts. Exits with 1 on the first
+// inconsistency.
+
+namespace {
+
+std::atomic<bool> failed{false};
+
+void fail(const char *what) {
+  if (!failed.exchange(true)) {
+    std::printf("FAIL: %s\n", what);
+  }
+}
+
+void check_snapshot(const leaderboard_snapshot &s) {
+  if (!std::is_sorted(s.entries.begin(), s.entries.end(), leaderboard_order)) {
+    fail("entries not sorted");
+  }
+  if (!std::is_sorted(s.user_best.begin(), s.user_best.end(),
+                      leaderboard_order)) {
+    fail("user_best not sorted");
+  }
+  std::set<std::string> users;
+  for (const leaderboard_entry &e : s.user_best) {
+    if (!users.insert(e.user_id).second) {
+      fail("user appears twice in user_best");
+    }
+  }
+  // The best entry of a user is the first of theirs in the full order.
+  std::set<std::string> seen;
+  for (const leaderboard_entry &e : s.entries) {
+    if (seen.insert(e.user_id).second && !users.count(e.user_id)) {
+      fail("user missing from user_best");
+    }
+  }
+  if (seen.size() != users.size()) {
+    fail("user_best has users without entries");
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  // clang-format off
+  cxxopts::Options options("LeaderboardStress", "Concurrent reads and inserts on leaderboard_store");
+  options.add_options()
+    ("readers", "Reader threads.", cxxopts::value<int>()->default_value("8"))
+    ("writers", "Writer threads.", cxxopts::value<int>()->default_value("2"))
+    ("bursts", "Bursts of inserts per writer.", cxxopts::value<int>()->default_value("50"))
+    ("burst-size", "Inserts per burst.", cxxopts::value<int>()->default_value("40"))
+    ("users", "Distinct users.", cxxopts::value<int>()->default_value("100"))
+    ("h,help", "Print usage.")
+    ;
+  // clang-format on
+  auto args = options.parse(argc, argv);
+  if (args.count("help")) {
+    std::cout << options.help() << std::endl;
+    return 0;
+  }
+  int num_readers = args["readers"].as<int>();
+  int num_writers = args["writers"].as<int>();
+  int bursts = args["bursts"].as<int>();
+  int burst_size = args["burst-size"].as<int>();
+  int users = std::max(1, args["users"].as<int>());
+
+  leaderboard_store store;
+  std::atomic<int> writers_left{num_writers};
+  std::atomic<long> snapshots_checked{0};
+
+  std::vector<std::thread> threads;
+  for (int w = 0; w < num_writers; ++w) {
+    threads.emplace_back([&, w]() {
+      std::mt19937 rng(w);
+      std::uniform_int_distribution<int> user(0, users - 1);
+      std::uniform_real_distribution<double> time(1e-3, 1.0);
+      for (int b = 0; b < bursts && !failed; ++b) {
+        for (int i = 0; i < burst_size; ++i) {
+          leaderboard_entry e;
+          e.task = "stress";
+          e.user_id = "user" + std::to_string(user(rng));
+          char id[32];
+          std::snprintf(id, sizeof(id), "%04d-%04x", b * burst_size + i, w);
+          e.submission_id = id;
+          // Coarse times, so that ties exercise the submission id order.
+          e.best_time = std::round(time(rng) * 100) / 100;
+          e.cycles_per_call = e.best_time;
+          store.insert(std::move(e));
+        }
+        std::this_thread::yield();
+      }
+      writers_left--;
+    });
+  }
+  for (int r = 0; r < num_readers; ++r) {
+    threads.emplace_back([&]() {
+      size_t last_size = 0;
+      long checked = 0;
+      do {
+        leaderboard_store::snapshot_ptr s = store.snapshot();
+        if (s->entries.size() < last_size) {
+          fail("snapshot shrank");
+        }
+        last_size = s->entries.size();
+        check_snapshot(*s);
+        checked++;
+      } while (writers_left > 0 && !failed);
+      snapshots_checked += checked;
+    });
+  }
+  for (std::thread &t : threads) {
+    t.join();
+  }
+
+  leaderboard_store::snapshot_ptr final_snapshot = store.snapshot();
+  check_snapshot(*final_snapshot);
+  size_t expected = size_t(num_writers) * bursts * burst_size;
+  if (!failed && final_snapshot->entries.size() != expected) {
+    fail("inserts lost");
+  }
+
+  // publish() must agree with the incremental inserts.
+  leaderboard_store rebuilt;
+  std::vector<leaderboard_entry> shuffled = final_snapshot->entries;
+  std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(1));
+  rebuilt.publish(shuffled);
+  leaderboard_store::snapshot_ptr r = rebuilt.snapshot();
+  auto same_ids = [](const std::vector<leaderboard_entry> &a,
+                     const std::vector<leaderboard_entry> &b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                      [](const auto &x, const auto &y) {
+                        return x.submission_id == y.submission_id &&
+                               x.user_id == y.user_id;
+                      });
+  };
+  if (!same_ids(r->entries, final_snapshot->entries) ||
+      !same_ids(r->user_best, final_snapshot->user_best)) {
+    fail("publish() and insert() disagree");
+  }
+
+  std::printf("%zu entries, %zu users, %ld snapshots checked: %s\n",
+              final_snapshot->entries.size(), final_snapshot->user_best.size(),
+              snapshots_checked.load(), failed ? "FAILED" : "ok");
+  return failed ? 1 : 0;
+}
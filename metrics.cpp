@@ -0,0 +1,75 @@
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+void append_metric_header(std::string &out, const std::string &name,
+                          const std::string &help, const std::string &type) {
+  out += "# HELP " + name + " " + help + "\n";
+  out += "# TYPE " + name + " " + type + "\n";
+}
+
+void append_metric_sample(std::string &out, const std::string &name,
+                          const std::string &labels, double value) {
+  char buf[64];
+  if (std::isinf(value)) {
+    std::snprintf(buf, sizeof(buf), value > 0 ? "+Inf" : "-Inf");
+  } else {
+    std::snprintf(buf, sizeof(buf), "%.9g", value);
+  }
+  out += name;
+  if (!labels.empty()) {
+    out += "{" + labels + "}";
+  }
+  out += " ";
+  out += buf;
+  out += "\n";
+}
+
+histogram::histogram(std::vector<double> bounds)
+    : bounds(std::move(bounds)),
+      counts(new std::atomic<uint64_t>[this->bounds.size() + 1]) {
+  for (size_t i = 0; i <= this->bounds.size(); ++i) {
+    counts[i] = 0;
+  }
+}
+
+void histogram::observe(double seconds) {
+  size_t bucket = 0;
+  while (bucket < bounds.size() && seconds > bounds[bucket]) {
+    ++bucket;
+  }
+  counts[bucket].fetch_add(1, std::memory_order_relaxed);
+  sum_ns.fetch_add(uint64_t(std::max(0.0, seconds) * 1e9),
+                   std::memory_order_relaxed);
+}
+
+void histogram::append(std::string &out, const std::string &name,
+                       const std::string &labels) const {
+  std::string prefix = labels.empty() ? "" : labels + ",";
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i < bounds.size(); ++i) {
+    cumulative += counts[i].load(std::memory_order_relaxed);
+    char le[32];
+    std::snprintf(le, sizeof(le), "%g", bounds[i]);
+    append_metric_sample(out, name + "_bucket",
+                         prefix + "le=\"" + le + "\"", cumulative);
+  }
+  cumulative += counts[bounds.size()].load(std::memory_order_relaxed);
+  append_metric_sample(out, name + "_bucket", prefix + "le=\"+Inf\"",
+                       cumulative);
+  append_metric_sample(out, name + "_sum", labels,
+                       sum_ns.load(std::memory_order_relaxed) * 1e-9);
+  // The count is the bucket total, so it always matches the +Inf bucket.
+  append_metric_sample(out, name + "_count", labels, cumulative);
+}
+
+std::vector<double> pipeline_buckets() {
+  return {0.05, 0.1, 0.25, 0.5, 1, 2, 4, 8, 16, 32, 64};
+}
+
+std::vector<double> http_buckets() {
+  return {0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1,
+          0.25,  0.5,    1,     2.5,  5,     10,   30};
+}
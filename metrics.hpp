@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Metrics in the Prometheus text exposition format. Updates are lock-free
+// atomic increments, so instrumented code paths pay next to nothing and a
+// scrape only reads counters.
+
+// Appends "# HELP" and "# TYPE" lines.
+void append_metric_header(std::string &out, const std::string &name,
+                          const std::string &help, const std::string &type);
+
+// Appends one sample line, e.g. name{labels} value. Labels are given without
+// braces and may be empty.
+void append_metric_sample(std::string &out, const std::string &name,
+                          const std::string &labels, double value);
+
+// Histogram of durations in seconds with fixed bucket upper bounds.
+struct histogram {
+  explicit histogram(std::vector<double> bounds);
+
+  void observe(double seconds);
+
+  // Appends the _bucket, _sum and _count samples (without header).
+  void append(std::string &out, const std::string &name,
+              const std::string &labels) const;
+
+  std::vector<double> bounds;  // ascending, +Inf is implicit
+
+ private:
+  std::unique_ptr<std::atomic<uint64_t>[]> counts;  // per bucket, not cumulative
+  std::atomic<uint64_t> sum_ns{0};
+};
+
+// Bucket bounds for pipeline steps (compile, benchmark, ...), in seconds.
+std::vector<double> pipeline_buckets();
+// Bucket bounds for HTTP request handling, in seconds.
+std::vector<double> http_buckets();
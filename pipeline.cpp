@@ -0,0 +1,169 @@
+#include "pipeline.hpp"
+
+#include "dataset.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#include <sys/wait.h>
+
+namespace {
+
+// Files compile.sh and the benchmark leave in the work directory that are
+// kept in the submission record.
+const char *pipeline_artifacts[] = {
+    "compile_stdout.log.ansi", "compile_stderr.log.ansi", "best_time.txt",
+    "benchmark_output",
+};
+
+void write_text(const std::filesystem::path &path, const std::string &text) {
+  std::ofstream file(path.string(), std::ios::binary);
+  file << text;
+}
+
+void set_file(submission_record &record, const std::string &name,
+              const std::filesystem::path &file) {
+  std::ifstream f(file.string(), std::ios::binary);
+  if (!f.is_open()) {
+    return;
+  }
+  std::stringstream buffer;
+  buffer << f.rdbuf();
+  record.set(name, buffer.str(), false);
+}
+
+}  // namespace
+
+std::string inline_field(const submission_record &record,
+                         const std::string &name) {
+  const record_field *f = record.find(name);
+  return f && !f->is_blob ? f->value : "";
+}
+
+submission_record pipeline_job::to_record() const {
+  submission_record record;
+  record.set("task", task, false);
+  record.set("submission_id", submission_id, false);
+  record.set("submitted_code.hpp", code, false);
+  record.set("flags.txt", flags, false);
+  record.set("task_flags.txt", task_flags, false);
+  record.set("symbol", symbol, false);
+  record.set("benchmark.cpp", benchmark_source, false);
+  record.set("multi_core", multi_core ? "1" : "0", false);
+  record.set("dataset", dataset, false);
+  return record;
+}
+
+pipeline_job pipeline_job::from_record(const submission_record &record) {
+  pipeline_job job;
+  job.task = inline_field(record, "task");
+  job.submission_id = inline_field(record, "submission_id");
+  job.code = inline_field(record, "submitted_code.hpp");
+  job.flags = inline_field(record, "flags.txt");
+  job.task_flags = inline_field(record, "task_flags.txt");
+  job.symbol = inline_field(record, "symbol");
+  job.benchmark_source = inline_field(record, "benchmark.cpp");
+  job.multi_core = inline_field(record, "multi_core") == "1";
+  job.dataset = inline_field(record, "dataset");
+  return job;
+}
+
+submission_record run_pipeline(const pipeline_job &job,
+                               const benchmark_policy &settings,
+                               const std::filesystem::path &work_root) {
+  std::printf("Running submission.\n");
+  std::filesystem::path work_dir = work_root;
+  work_dir /= job.task;
+  work_dir /= job.submission_id;
+  std::printf("   + mkdir: %s\n", work_dir.c_str());
+  std::filesystem::create_directories(work_dir);
+
+  std::printf("   + write code: %s\n",
+              (work_dir / "submitted_code.hpp").c_str());
+  write_text(work_dir / "submitted_code.hpp", job.code);
+  std::printf("   + write flags: %s\n", (work_dir / "flags.txt").c_str());
+  write_text(work_dir / "flags.txt", job.flags);
+  if (!job.task_flags.empty()) {
+    write_text(work_dir / "task_flags.txt", job.task_flags);
+  }
+  std::printf("   + write benchmark.cpp\n");
+  write_text(work_dir / "benchmark.cpp", job.benchmark_source);
+
+  std::string command = "/bin/bash ";
+  command += std::filesystem::absolute("runtime/compile.sh").string();
+  command += " ";
+  command += work_dir.string();
+  command += " ";
+  command += job.symbol;  // Symbol to get the disassembly of.
+  command += " ";
+  command += std::to_string(settings.compile_timeout_seconds);
+  std::printf("Executing command:\n%s\n", command.c_str());
+  auto compile_start = std::chrono::steady_clock::now();
+  machine_lock compile_lock(machine_lock::mode::shared);
+  int exit_code = std::system(command.c_str());
+  compile_lock.unlock();
+  double compile_seconds = std::chrono::duration<double>(
+      std::chrono::steady_clock::now() - compile_start).count();
+  int status = WEXITSTATUS(exit_code);
+  std::printf("code: %d\n", status);
+
+  submission_record record;
+  // The benchmark runs outside compile.sh so it can be reaped with wait4()
+  // and its resource usage recorded.
+  if (status == 0 && !link_dataset(work_dir, job.dataset)) {
+    write_text(work_dir / "benchmark_output", "Dataset unavailable.\n");
+    status = 2;
+  }
+  if (status == 0) {
+    std::printf("Running...\n");
+    benchmark_policy policy = settings;
+    policy.multi_core = job.multi_core;
+    auto benchmark_start = std::chrono::steady_clock::now();
+    benchmark_run run = run_benchmark(work_dir, policy);
+    double benchmark_seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - benchmark_start).count();
+    status = run.status;
+    record.set("benchmark_seconds", std::to_string(benchmark_seconds), false);
+    record.set("rusage", run.usage.to_text(), false);
+    record.set("calibration", run.calibration.to_text(), false);
+  }
+  record.set("exit_code", std::to_string(status), false);
+  record.set("compile_seconds", std::to_string(compile_seconds), false);
+  record.set("benchmark.cpp", job.benchmark_source, false);
+  set_file(record, "benchmark", work_dir / "benchmark");
+  for (const char *artifact : pipeline_artifacts) {
+    set_file(record, artifact, work_dir / artifact);
+  }
+  std::filesystem::remove_all(work_dir);
+  return record;
+}
+
+bool is_pipeline_output(const std::string &field) {
+  static const char *fields[] = {
+      "exit_code", "compile_seconds", "benchmark_seconds", "rusage",
+      "calibration", "benchmark.cpp", "benchmark",
+  };
+  for (const char *f : fields) {
+    if (field == f) {
+      return true;
+    }
+  }
+  for (const char *artifact : pipeline_artifacts) {
+    if (field == artifact) {
+      return true;
+    }
+  }
+  return false;
+}
+
+double max_pipeline_seconds(const benchmark_policy &settings) {
+  // Compile.sh may take 5 seconds to kill the compiler; each attempt runs two
+  // calibrations of well under a second each.
+  return settings.compile_timeout_seconds + 5 +
+         std::max(1, settings.max_attempts) * (settings.timeout_seconds + 5) +
+         30;
+}
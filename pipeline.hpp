@@ -0,0 +1,48 @@
+#pragma once
+
+#include "artifact_store.hpp"
+#include "benchmark_runner.hpp"
+
+#include <filesystem>
+#include <string>
+
+// Everything needed to compile and benchmark one submission, independent of
+// the machine it runs on. Sent to remote workers as a submission record.
+struct pipeline_job {
+  std::string task;
+  std::string submission_id;
+  std::string code;
+  std::string flags;
+  std::string task_flags;
+  std::string symbol;
+  std::string benchmark_source;  // the task's benchmark.cpp
+  std::string dataset;           // the task's dataset spec, if any
+  bool multi_core{false};
+
+  submission_record to_record() const;
+  static pipeline_job from_record(const submission_record &record);
+};
+
+// Compiles and benchmarks the job in <work_root>/<task>/<submission_id> with
+// runtime/compile.sh (relative to the working directory) and removes the
+// directory afterwards. The task's dataset is generated on this machine if it
+// does not exist yet. The returned record has only inline fields:
+// exit_code, compile_seconds, benchmark_seconds, rusage and calibration (if
+// benchmarked), benchmark.cpp, the benchmark binary and the compile and
+// benchmark output files.
+submission_record run_pipeline(const pipeline_job &job,
+                               const benchmark_policy &settings,
+                               const std::filesystem::path &work_root);
+
+// Whether a field may appear in the record returned by run_pipeline(). Results
+// of remote workers with other fields are rejected.
+bool is_pipeline_output(const std::string &field);
+
+// Upper bound on the duration of run_pipeline() with these settings, once the
+// dataset exists: the compile limit, every benchmark attempt up to its timeout,
+// and an allowance for calibrations and file transfers.
+double max_pipeline_seconds(const benchmark_policy &settings);
+
+// Returns the value of a field that is known to be inline; empty if absent.
+std::string inline_field(const submission_record &record,
+                         const std::string &name);
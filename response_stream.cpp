@@ -0,0 +1,137 @@
+#include "response_stream.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+std::vector<template_segment> parse_template(const std::string &text) {
+  std::vector<template_segment> segments;
+  size_t pos = 0;
+  while (true) {
+    size_t open = text.find("${", pos);
+    size_t close =
+        open == std::string::npos ? std::string::npos : text.find('}', open);
+    if (close == std::string::npos) {
+      segments.push_back({text.substr(pos), ""});
+      return segments;
+    }
+    segments.push_back(
+        {text.substr(pos, open - pos), text.substr(open + 2, close - open - 2)});
+    pos = close + 1;
+  }
+}
+
+}  // namespace
+
+template_ptr load_template(const std::filesystem::path &path) {
+  struct cached {
+    std::filesystem::file_time_type mtime;
+    template_ptr segments;
+  };
+  static std::mutex mutex;
+  static std::map<std::filesystem::path, cached> cache;
+
+  std::error_code ec;
+  auto mtime = std::filesystem::last_write_time(path, ec);
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = cache.find(path);
+    if (it != cache.end() && !ec && it->second.mtime == mtime) {
+      return it->second.segments;
+    }
+  }
+  std::ifstream f(path.string(), std::ios::binary);
+  std::stringstream buffer;
+  buffer << f.rdbuf();
+  template_ptr segments =
+      std::make_shared<const std::vector<template_segment>>(
+          parse_template(buffer.str()));
+  std::lock_guard<std::mutex> lock(mutex);
+  cache[path] = {mtime, segments};
+  return segments;
+}
+
+struct response_stream::mapped_file {
+  explicit mapped_file(const std::filesystem::path &path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+      return;
+    }
+    off_t end = lseek(fd, 0, SEEK_END);
+    if (end > 0) {
+      void *p = mmap(nullptr, end, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED) {
+        data = static_cast<const char *>(p);
+        size = end;
+        madvise(p, size, MADV_SEQUENTIAL);
+      }
+    }
+    close(fd);
+  }
+  ~mapped_file() {
+    if (data) {
+      munmap(const_cast<char *>(data), size);
+    }
+  }
+
+  const char *data{nullptr};
+  size_t size{0};
+};
+
+void response_stream::append(std::string text) {
+  if (text.empty()) {
+    return;
+  }
+  size_t size = text.size();
+  parts.push_back({total, size, std::move(text), {}, nullptr});
+  total += size;
+}
+
+void response_stream::append_file(const std::filesystem::path &path) {
+  std::error_code ec;
+  size_t size = std::filesystem::file_size(path, ec);
+  if (ec || size == 0) {
+    return;
+  }
+  parts.push_back({total, size, {}, path, nullptr});
+  total += size;
+}
+
+bool response_stream::write(size_t offset, size_t max_chunk,
+                            const writer &out) {
+  auto it = std::upper_bound(
+      parts.begin(), parts.end(), offset,
+      [](size_t o, const part &p) { return o < p.begin; });
+  if (it == parts.begin()) {
+    return false;
+  }
+  part &p = *--it;
+  size_t within = offset - p.begin;
+  size_t length = std::min(max_chunk, p.size - within);
+  if (p.file.empty()) {
+    return out(p.text.data() + within, length);
+  }
+  if (!p.mapping) {
+    p.mapping = std::make_shared<mapped_file>(p.file);
+  }
+  size_t available =
+      within < p.mapping->size ? std::min(length, p.mapping->size - within) : 0;
+  if (available > 0) {
+    bool ok = out(p.mapping->data + within, available);
+    if (within + available == p.size) {
+      p.mapping.reset();  // the part is done
+    }
+    return ok;
+  }
+  std::string padding(std::min<size_t>(length, 4096), '\n');
+  return out(padding.data(), padding.size());
+}
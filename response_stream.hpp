@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// An HTML template split at its ${PLACEHOLDER}s: literal text followed by the
+// name of the placeholder after it (empty for the last segment).
+struct template_segment {
+  std::string literal;
+  std::string placeholder;
+};
+
+using template_ptr = std::shared_ptr<const std::vector<template_segment>>;
+
+// Parsed template, cached in memory and re-read only when the file changes.
+template_ptr load_template(const std::filesystem::path &path);
+
+// A response body assembled from in-memory strings and whole files. Files are
+// mapped and written in chunks while the body is sent, so the body is never
+// copied into one buffer and memory per request does not grow with the
+// size of the artifacts.
+struct response_stream {
+  using writer = std::function<bool(const char *data, size_t size)>;
+
+  void append(std::string text);
+  // The file size is taken now; a file that shrinks before it is sent is
+  // padded with newlines so the announced length stays correct.
+  void append_file(const std::filesystem::path &path);
+
+  size_t size() const { return total; }
+
+  // Writes at most max_chunk bytes starting at offset. Returns false if the
+  // writer failed.
+  bool write(size_t offset, size_t max_chunk, const writer &out);
+
+ private:
+  struct mapped_file;
+  struct part {
+    size_t begin;  // offset in the body
+    size_t size;
+    std::string text;
+    std::filesystem::path file;
+    std::shared_ptr<mapped_file> mapping;  // mapped on first write
+  };
+
+  std::vector<part> parts;
+  size_t total{0};
+};
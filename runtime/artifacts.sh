@@ -0,0 +1,41 @@
+#!/bin/bash -eux
+
+echo "Generating artifacts..."
+
+
+DIR=$1
+cd $DIR
+
+SYMBOL=$2
+
+# Syntax highlight source
+highlight -s molokai -O html --inline-css -f -o submitted_code.highlight.html submitted_code.hpp
+
+cat compile_stdout.log.ansi | aha --no-header > compile_stdout.log.html
+cat compile_stderr.log.ansi | aha --no-header > compile_stderr.log.html
+
+BINARY="benchmark"
+if [ ! -e $BINARY ]; then
+  echo "No binary, compile failed."
+  exit 0
+fi
+
+# Get disassembly from function
+OBJDUMP=$HOME/w/3rd/binutils/binutils/objdump
+if [ ! -e $OBJDUMP ]; then
+  OBJDUMP=$HOME/binutils-2.40/build/binutils/objdump
+fi
+if [ ! -e $OBJDUMP ]; then
+  OBJDUMP=objdump
+fi
+
+if [[ ! -z "${SYMBOL}" ]]; then
+  echo "Using symbol name '${SYMBOL}' given as variable."
+fi
+$OBJDUMP $BINARY --disassembler-color=extended-color --visualize-jumps=extended-color --disassemble=$SYMBOL --no-addresses --no-show-raw-insn > disassembly.ansi
+$OBJDUMP $BINARY --disassembler-color=extended-color --visualize-jumps=extended-color --disassemble=$SYMBOL --no-addresses --no-show-raw-insn -S > disassembly_with_source.ansi
+cat disassembly.ansi | aha --no-header > disassembly.html
+cat disassembly_with_source.ansi | aha --no-header > disassembly_with_source.html
+
+echo "Artifacts.sh completed succesfully"
+exit 0
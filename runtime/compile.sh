@@ -7,57 +7,27 @@ DIR=$1
 cd $DIR
 
 SYMBOL=$2
+COMPILE_TIMEOUT=${3:-60}
 
-# Syntax highlight source
-highlight -s molokai -O html --inline-css -f -o submitted_code.highlight.html submitted_code.hpp
-
-
-# Compile
+# Compile. Highlighting and disassembly are left to artifacts.sh, which runs
+# when the submission is first viewed. Debug paths are made relative so that
+# objdump -S finds the sources wherever the artifacts are generated.
 FLAGS="$(cat flags.txt)"
+if [ -e task_flags.txt ]; then
+  FLAGS="$FLAGS $(cat task_flags.txt)"
+fi
 BINARY="benchmark"
-g++ -g benchmark.cpp -o $BINARY -fdiagnostics-color=always $FLAGS > compile_stdout.log.ansi 2> compile_stderr.log.ansi
-COMPILE_RESULT=$?
-cat compile_stdout.log.ansi | aha --no-header > compile_stdout.log.html
-cat compile_stderr.log.ansi | aha --no-header > compile_stderr.log.html
+COMPILE_RESULT=0
+timeout --kill-after=5 $COMPILE_TIMEOUT g++ -g -fdebug-prefix-map=$PWD=. benchmark.cpp -o $BINARY -fdiagnostics-color=always $FLAGS > compile_stdout.log.ansi 2> compile_stderr.log.ansi || COMPILE_RESULT=$?
+
+if [ $COMPILE_RESULT == 124 ] || [ $COMPILE_RESULT == 137 ]; then
+  echo "Compilation exceeded ${COMPILE_TIMEOUT}s." >> compile_stderr.log.ansi
+fi
 
 if [ $COMPILE_RESULT != 0 ]; then
   echo "Compile failed."
-  echo "1" > exit_code
   exit 1
 fi
 
-# Get disassembly from function
-OBJDUMP=$HOME/w/3rd/binutils/binutils/objdump
-if [ ! -e $OBJDUMP ]; then
-  OBJDUMP=$HOME/binutils-2.40/build/binutils/objdump
-fi
-if [ ! -e $OBJDUMP ]; then
-  OBJDUMP=objdump
-fi
-
-if [[ ! -z "${SYMBOL}" ]]; then
-  echo "Using symbol name '${SYMBOL}' given as variable."
-fi
-$OBJDUMP $BINARY --disassembler-color=extended-color --visualize-jumps=extended-color --disassemble=$SYMBOL --no-addresses --no-show-raw-insn > disassembly.ansi
-$OBJDUMP $BINARY --disassembler-color=extended-color --visualize-jumps=extended-color --disassemble=$SYMBOL --no-addresses --no-show-raw-insn -S > disassembly_with_source.ansi
-cat disassembly.ansi | aha --no-header > disassembly.html
-cat disassembly_with_source.ansi | aha --no-header > disassembly_with_source.html
-
-echo "Running..."
-
-timeout 8 ./benchmark > best_time.txt 2> benchmark_output
-BENCHMARK_RESULT=$?
-
-if [ $BENCHMARK_RESULT == 124 ]; then
-  echo "Timeout"
-  echo "4" > exit_code
-  exit 4
-elif [ $BENCHMARK_RESULT != 0 ]; then
-  echo "Benchmark unhappy (status $BENCHMARK_RESULT)"
-  echo "2" > exit_code
-  exit 2
-fi
-
 echo "Compile.sh completed succesfully"
-echo "0" > exit_code
 exit 0
@@ -1,14 +1,48 @@
 #include <httplib.h>
 
+#include "artifact_store.hpp"
+#include "benchmark_runner.hpp"
+#include "compare.hpp"
+#include "dataset.hpp"
+#include "leaderboard.hpp"
+#include "metrics.hpp"
+#include "pipeline.hpp"
+#include "response_stream.hpp"
+#include "validation.hpp"
+#include "worker_protocol.hpp"
+
+#include <atomic>
+#include <cinttypes>
+#include <cmath>
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
+#include <cstring>
+#include <ctime>
 #include <cxxopts.hpp>
+#include <deque>
 #include <filesystem>
 #include <fstream>
-#if STORE_LEADERBOARD
+#include <functional>
+#include <iomanip>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <nlohmann/json.hpp>
-#endif
-#include <regex>
 #include <sstream>
+#include <thread>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+std::string strip_newlines(const std::string &str) {
+  int begin = 0;
+  while (begin < str.size() && str[begin] == '\n') { ++begin; }
+  int end = str.size();
+  while (end > 0 && str[end - 1] == '\n') { --end; }
+  return str.substr(begin, end - begin);
+}
 
 std::string read_file(std::filesystem::path path, bool strip=true) {
   std::ifstream t(path.string());
@@ -16,77 +50,12 @@ std::string read_file(std::filesystem::path path, bool strip=true) {
   buffer << t.rdbuf();
   std::string str = buffer.str();
   if (strip) {
-    int begin = 0;
-    while (begin < str.size() && str[begin] == '\n') { ++begin; }
-    int end = str.size();
-    while (end > 0 && str[end - 1] == '\n') { --end; }
-    return str.substr(begin, end - begin);
+    return strip_newlines(str);
   } else {
     return str;
   }
 }
 
-inline bool contains(const std::string &code, std::string substr) {
-  return code.find(substr) != std::string::npos;
-}
-inline bool contains_regex(const std::string &code, std::string regex) {
-  std::regex r(regex);
-  return std::regex_search(code, r);
-}
-
-static std::vector<std::string> task_specific_bad_code_regex;
-
-bool validate_code_input(const std::string &code) {
-  // clang-format off
-  static std::vector<std::string> bad_code_regex = {
-      // spawn process:
-      "system", "execl", "execlp", "execle", "execv", "execvp", "execvpe",
-      "fork",
-      // inline assembly:
-      "\\basm",
-      // overriding main:
-      "\\bmain\\b", "argv", "argc", "\\b_main\\b", "\\bstart\\b",
-      // abusive memory:
-      "calloc", "malloc", "free", "\\bnew\\b", "\\bmmap\\b",
-      // multithrading:
-      "pthread", "async", "launch", "thread",
-      // File IO
-      "fstream", "fopen", "fputc", "filesystem", "directory_iterator", "dirent", "opendir", "readdir", "fread", "fwrite",
-      // Stdin/stdout
-      "printf", "puts", "fputs", "putc", "\\bcout\\b", "\\bcerr\\b", "\\bcin\\b",
-  };
-  static std::vector<std::string> bad_code_plain = {
-      // Digraphs and preprocessor
-      "<%", "%>", "<:", ":>", "%:", "%:%:", "#",
-  };
-  // clang-format on
-  for (const std::string &regex : bad_code_regex) {
-    if (contains_regex(code, regex)) {
-      return false;
-    }
-  }
-  for (const std::string &plain : bad_code_plain) {
-    if (contains(code, plain)) {
-      return false;
-    }
-  }
-  return true;
-}
-
-bool validate_flags(const std::string &flags) {
-  // clang-format off
-  static std::vector<std::string> bad_flags = {
-    ";", "&&", "||", "|", "&", ".", "/", "<", ">"
-  };
-  // clang-format on
-  for (const std::string &str : bad_flags) {
-    if (contains(flags, str)) {
-      return false;
-    }
-  }
-  return true;
-}
-
 struct submission_result {
   bool found{false};
 
@@ -107,16 +76,37 @@ struct submission_result {
   std::string compiler_output;
   double best_time{std::numeric_limits<double>::infinity()};
   double cycles_per_call{std::numeric_limits<double>::infinity()};
-};
 
-struct leaderboard_entry {
-  std::string task;
-  std::string user_id;
-  std::string submission_id;
-  double best_time;
-  double cycles_per_call;
-  std::string author;
+  bool has_usage{false};
+  benchmark_usage usage;
+
+  bool has_calibration{false};
+  calibration_pair calibration;
+  double normalized_time{std::numeric_limits<double>::quiet_NaN()};
+
+  // Duration of compile.sh on the submit path and of artifacts.sh on first
+  // view; negative if unknown.
+  double compile_seconds{-1};
+  double artifact_seconds{-1};
+
+  // Epoch of the task when it was submitted, see task_config::epoch.
+  int epoch{0};
+
+  // Files holding the large fields (code, compiler_output, disassembly,
+  // disassembly_with_source, benchmark_output) when they are loaded for
+  // streaming; the string members are left empty then.
+  std::map<std::string, std::filesystem::path> files;
+
+  // Results per thread count, for tasks in scaling mode.
+  struct scaling_point {
+    int threads;
+    double best_time;
+    double throughput;  // elements per second
+    double efficiency;  // throughput / (threads * single-thread throughput)
+  };
+  std::vector<scaling_point> scaling;
 };
+
 #if STORE_LEADERBOARD
 NLOHMANN_DEFINE_TYPE_NON_INTRUSIVE(leaderboard_entry, task, user_id,
                                    submission_id, best_time, cycles_per_call);
@@ -130,121 +120,537 @@ leaderboard_entry make_leaderboard_entry(const submission_result &r) {
   e.submission_id = r.submission_id;
   e.cycles_per_call = r.cycles_per_call;
   e.author = r.author;
+  e.normalized_time = r.normalized_time;
   return e;
 }
 
+// Produced by runtime/artifacts.sh the first time a submission is viewed,
+// rather than on the submit path. Records from before lazy generation already
+// contain them.
+static const char *display_artifacts[] = {
+    "submitted_code.highlight.html", "compile_stdout.log.html",
+    "compile_stderr.log.html",       "disassembly.html",
+    "disassembly_with_source.html",
+};
+
+static artifact_store store(".");
+static benchmark_policy benchmark_settings;
+
+// Counters and histograms exported on /metrics.
+struct server_metrics {
+  histogram compile_seconds{pipeline_buckets()};
+  histogram benchmark_seconds{pipeline_buckets()};
+  histogram artifact_seconds{pipeline_buckets()};
+  // Indexed by the submission exit_code (0 ok, 1 compile failed, 2 benchmark
+  // failed, 4 timeout, 5 calibration drift).
+  std::atomic<uint64_t> outcomes[6]{};
+  std::atomic<uint64_t> rejected{0};
+  std::atomic<uint64_t> artifact_hits{0};
+  std::atomic<uint64_t> artifact_misses{0};
+  // Per "METHOD pattern"; filled while the routes are registered, read-only
+  // once the server listens. Handler time only: a streamed response (the
+  // submission view) is sent after the handler returns, so its transfer is not
+  // included.
+  std::map<std::string, std::unique_ptr<histogram>> http;
+
+  httplib::Server::Handler timed(const std::string &method,
+                                 const std::string &pattern,
+                                 httplib::Server::Handler handler) {
+    auto &h = http[method + " " + pattern];
+    h = std::make_unique<histogram>(http_buckets());
+    histogram *route = h.get();
+    return [route, handler = std::move(handler)](const httplib::Request &req,
+                                                 httplib::Response &res) {
+      auto start = std::chrono::steady_clock::now();
+      handler(req, res);
+      route->observe(std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start)
+                         .count());
+    };
+  }
+
+  void count_outcome(int status) {
+    if (status >= 0 && status < 6) {
+      outcomes[status]++;
+    }
+  }
+};
+static server_metrics metrics;
+// Calibration kernel time of the machine in its reference state. Benchmark
+// times are normalized to it using the calibration taken around each run.
+static double calibration_reference = 0.0;
+
+// The reference is measured on the benchmark core, like the calibrations
+// around every run, and remeasured when the core changes: cores of different
+// types or frequency limits would otherwise bias every normalized time.
+double load_calibration_reference(int cpu) {
+  std::filesystem::path path = "calibration_reference";
+  double reference = 0.0;
+  if (std::filesystem::exists(path)) {
+    std::stringstream ss(read_file(path));
+    int reference_cpu = -2;
+    if (!(ss >> reference >> reference_cpu) || reference_cpu != cpu) {
+      reference = 0.0;
+    }
+  }
+  if (reference <= 0.0) {
+    std::printf("Measuring calibration reference...\n");
+    for (int i = 0; i < 3; ++i) {
+      double t = run_calibration(cpu).total();
+      reference = reference > 0.0 ? std::min(reference, t) : t;
+    }
+    std::ofstream f(path.string());
+    f << std::setprecision(9) << reference << " " << cpu << "\n";
+  }
+  std::printf("Calibration reference: %.3f ms.\n", reference * 1e3);
+  return reference;
+}
+
+// Benchmark workers connected over --worker-listen. Each worker runs one job
+// at a time; run() hands the job to an idle worker and waits for its result.
+// A job whose worker disconnects, does not answer within the time the worker
+// announced in its hello, or answers with fields run_pipeline() does not
+// produce, is retried on another one.
+struct remote_worker_pool {
+  remote_worker_pool(int listen_fd, std::string token)
+      : listen_fd(listen_fd), token(std::move(token)) {
+    acceptor = std::thread([this]() { accept_loop(); });
+  }
+
+  ~remote_worker_pool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    shutdown(listen_fd, SHUT_RDWR);
+    close(listen_fd);
+    acceptor.join();
+    cv.notify_all();
+    for (auto &w : workers) {
+      close(w->fd);
+    }
+  }
+
+  // Returns false if the pool is shutting down or the job lost its worker
+  // max_attempts times.
+  bool run(const pipeline_job &job, submission_record &output) {
+    constexpr int max_attempts = 3;
+    std::string payload = job.to_record().encode();
+    for (int attempt = 1; attempt <= max_attempts; ++attempt) {
+      std::shared_ptr<worker> w;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&]() { return stopping || (w = take_idle()); });
+        if (stopping) {
+          return false;
+        }
+      }
+      std::printf("Sending %s/%s to worker %s.\n", job.task.c_str(),
+                  job.submission_id.c_str(), w->name.c_str());
+      frame_type type;
+      std::string result;
+      if (write_frame(w->fd, frame_type::job, payload) &&
+          read_frame(w->fd, type, result, w->job_seconds) &&
+          type == frame_type::result && output.decode(result) &&
+          valid_result(output)) {
+        std::lock_guard<std::mutex> lock(mutex);
+        w->busy = false;
+        cv.notify_one();
+        return true;
+      }
+      std::printf("Worker %s disconnected, timed out or sent an invalid "
+                  "result, rescheduling %s.\n",
+                  w->name.c_str(), job.submission_id.c_str());
+      std::lock_guard<std::mutex> lock(mutex);
+      close(w->fd);
+      workers.erase(std::find(workers.begin(), workers.end(), w));
+    }
+    return false;
+  }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return workers.size();
+  }
+
+ private:
+  struct worker {
+    int fd;
+    std::string name;
+    double job_seconds;
+    bool busy{false};
+  };
+
+  static bool valid_result(const submission_record &output) {
+    for (const record_field &f : output.fields) {
+      if (!is_pipeline_output(f.name)) {
+        return false;
+      }
+    }
+    return output.find("exit_code") != nullptr;
+  }
+
+  // Must be called with the mutex held.
+  std::shared_ptr<worker> take_idle() {
+    for (auto &w : workers) {
+      if (!w->busy) {
+        w->busy = true;
+        return w;
+      }
+    }
+    return nullptr;
+  }
+
+  void accept_loop() {
+    while (true) {
+      int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+      if (fd < 0) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopping) {
+          return;
+        }
+        continue;
+      }
+      // A connection that does not say hello promptly must not hold up the
+      // registration of the next one.
+      constexpr double hello_timeout = 5;
+      constexpr uint64_t max_hello_size = 4096;
+      frame_type type;
+      std::string payload;
+      worker_hello hello;
+      if (!read_frame(fd, type, payload, hello_timeout, max_hello_size) ||
+          type != frame_type::hello || !check_hello(payload, token, hello)) {
+        std::printf("Rejected a worker connection without a valid hello.\n");
+        close(fd);
+        continue;
+      }
+      int one = 1;
+      setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+      std::printf("Worker %s registered, jobs take at most %.0fs.\n",
+                  hello.name.c_str(), hello.job_seconds);
+      std::lock_guard<std::mutex> lock(mutex);
+      workers.push_back(
+          std::make_shared<worker>(worker{fd, hello.name, hello.job_seconds}));
+      cv.notify_one();
+    }
+  }
+
+  int listen_fd;
+  std::string token;
+  mutable std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<std::shared_ptr<worker>> workers;
+  bool stopping{false};
+  std::thread acceptor;
+};
+
+// Runs the pipeline locally, or on a remote worker if there is a pool, and
+// stores the submission. Returns its exit code, or submission_not_stored.
+constexpr int submission_not_stored = -1;
 int run_validated_submission(const std::string &task,
                              const std::string &user_id,
                              const std::string &submission_id,
                              const std::string &code, const std::string &flags,
                              const std::string &symbol,
-                             const std::string &author, const std::string &ip) {
-  std::printf("Running submission.\n");
-  std::filesystem::path submission_dir = "submissions";
-  submission_dir /= task;
-  submission_dir /= submission_id;
-  std::printf("   + mkdir: %s\n", submission_dir.c_str());
-  std::filesystem::create_directories(submission_dir);
+                             const std::string &author, const std::string &ip,
+                             const std::string &task_flags, bool multi_core,
+                             const std::string &dataset, int epoch,
+                             remote_worker_pool *remote) {
+  pipeline_job job;
+  job.task = task;
+  job.submission_id = submission_id;
+  job.code = code;
+  job.flags = flags;
+  job.task_flags = task_flags;
+  job.symbol = symbol;
+  job.benchmark_source = read_file(
+      std::filesystem::path("tasks") / task / "benchmark.cpp", false);
+  job.multi_core = multi_core;
+  job.dataset = dataset;
+
+  submission_record output;
+  if (remote) {
+    if (!remote->run(job, output)) {
+      output = submission_record();
+      output.set("exit_code", "2", false);
+      output.set("compile_seconds", "0", false);
+      output.set("benchmark_output", "No worker could run the submission.",
+                 false);
+    }
+  } else {
+    output = run_pipeline(job, benchmark_settings, "work");
+  }
+
+  int status = std::atoi(inline_field(output, "exit_code").c_str());
+  metrics.count_outcome(status);
+  metrics.compile_seconds.observe(
+      std::atof(inline_field(output, "compile_seconds").c_str()));
+  if (output.find("benchmark_seconds")) {
+    metrics.benchmark_seconds.observe(
+        std::atof(inline_field(output, "benchmark_seconds").c_str()));
+  }
 
-  {
-    std::filesystem::path submission_header =
-        submission_dir / "submitted_code.hpp";
-    std::printf("   + write code: %s\n", submission_header.c_str());
-    std::ofstream file(submission_header.string());
-    file << code;
-    file.close();
-  }
-
-  {
-    std::filesystem::path flags_path = submission_dir / "flags.txt";
-    std::printf("   + write flags: %s\n", flags_path.c_str());
-    std::ofstream flags_file(flags_path.string());
-    flags_file << flags;
-    flags_file.close();
-  }
-
-  {
-    std::filesystem::path userid_path = submission_dir / "user_id";
-    std::printf("   + write user_id: %s\n", userid_path.c_str());
-    std::ofstream userid_file(userid_path.string());
-    userid_file << user_id;
-    userid_file.close();
-  }
-  {
-    std::filesystem::path author_path = submission_dir / "author";
-    std::printf("   + write author: %s\n", author_path.c_str());
-    std::ofstream author_file(author_path.string());
-    author_file << author;
-    author_file.close();
-  }
-  {
-    std::filesystem::path ip_path = submission_dir / "ip";
-    std::printf("   + write ip: %s\n", ip_path.c_str());
-    std::ofstream ip_file(ip_path.string());
-    ip_file << ip;
-    ip_file.close();
-  }
-
-  std::printf("   + copy benchmark.cpp\n");
-  std::filesystem::path benchmark_file = "tasks";
-  benchmark_file /= task;
-  benchmark_file /= "benchmark.cpp";
-  std::filesystem::copy_file(benchmark_file, submission_dir / "benchmark.cpp",
-                             std::filesystem::copy_options::overwrite_existing);
-
-  std::string command = "/bin/bash ";
-  command += std::filesystem::absolute("runtime/compile.sh").string();
-  command += " ";
-  command += submission_dir.string();
-  command += " ";
-  command += symbol; // Symbol to get the disassembly of.
-  std::printf("Executing command:\n%s\n", command.c_str());
-  int exit_code = std::system(command.c_str());
-  int status = WEXITSTATUS(exit_code);
-  std::printf("code: %d\n", status);
+  submission_record record;
+  bool stored = store.put(record, "submitted_code.hpp", code) &&
+                store.put(record, "flags.txt", flags);
+  for (const record_field &f : output.fields) {
+    // The harness and the binary are shared by, respectively, all and no
+    // other submissions; both always go to the blob store.
+    bool force_blob = f.name == "benchmark.cpp" || f.name == "benchmark";
+    stored = stored && store.put(record, f.name, f.value, force_blob);
+  }
+  stored = stored && store.put(record, "user_id", user_id) &&
+           store.put(record, "author", author) && store.put(record, "ip", ip) &&
+           store.put(record, "task_epoch", std::to_string(epoch));
+  std::printf("   + write record: %s\n",
+              store.record_path(task, submission_id).c_str());
+  // A record is only written if every blob it references exists.
+  if (!stored || !store.write_record(task, submission_id, record)) {
+    std::printf("Could not store submission %s/%s.\n", task.c_str(),
+                submission_id.c_str());
+    return submission_not_stored;
+  }
 
   return status;
 }
 
+// Generates the display artifacts of stored submissions on demand. Each
+// submission is generated at most once at a time: concurrent viewers of the
+// same submission wait for the first one's result. A submission whose
+// generation failed is not retried for failure_ttl, so that views of it do not
+// run the generator again each time.
+struct artifact_generator {
+  static constexpr std::chrono::minutes failure_ttl{10};
+
+  // Generates and stores the display artifacts if the record lacks them.
+  // Returns true if the record changed, i.e. it has to be reloaded.
+  bool generate_if_missing(const std::string &task,
+                           const std::string &submission_id,
+                           const std::string &symbol) {
+    if (!missing(task, submission_id)) {
+      metrics.artifact_hits++;
+      return false;
+    }
+    std::string key = task + "/" + submission_id;
+    std::promise<bool> promise;
+    std::shared_future<bool> result;
+    bool owner = false;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      auto failure = failed.find(key);
+      if (failure != failed.end()) {
+        if (std::chrono::steady_clock::now() - failure->second < failure_ttl) {
+          return false;
+        }
+        failed.erase(failure);
+      }
+      metrics.artifact_misses++;
+      auto it = in_flight.find(key);
+      if (it == in_flight.end()) {
+        result = promise.get_future().share();
+        in_flight.emplace(key, result);
+        owner = true;
+      } else {
+        result = it->second;
+      }
+    }
+    if (!owner) {
+      return result.get();
+    }
+    // Another request may have finished between the check and the lock.
+    bool generated = missing(task, submission_id) &&
+                     generate(task, submission_id, symbol);
+    promise.set_value(generated);
+    bool failed_now = !generated && missing(task, submission_id);
+    std::lock_guard<std::mutex> lock(mutex);
+    in_flight.erase(key);
+    if (failed_now) {
+      auto now = std::chrono::steady_clock::now();
+      for (auto it = failed.begin(); it != failed.end();) {
+        it = now - it->second < failure_ttl ? std::next(it) : failed.erase(it);
+      }
+      failed[key] = now;
+    }
+    return generated;
+  }
+
+ private:
+  static bool missing(const std::string &task,
+                      const std::string &submission_id) {
+    submission_record record;
+    return store.read_record(task, submission_id, record) &&
+           !record.find("compile_stderr.log.html");
+  }
+
+  static bool generate(const std::string &task,
+                       const std::string &submission_id,
+                       const std::string &symbol) {
+    submission_record record;
+    if (!store.read_record(task, submission_id, record)) {
+      return false;
+    }
+    std::filesystem::path dir = "work";
+    dir /= "artifacts";
+    dir /= task;
+    dir /= submission_id;
+    std::filesystem::create_directories(dir);
+    for (const char *input :
+         {"submitted_code.hpp", "benchmark.cpp", "benchmark",
+          "compile_stdout.log.ansi", "compile_stderr.log.ansi"}) {
+      store.extract(record, input, dir / input);
+    }
+
+    std::string command = "/bin/bash ";
+    command += std::filesystem::absolute("runtime/artifacts.sh").string();
+    command += " ";
+    command += dir.string();
+    command += " ";
+    command += symbol;
+    // Like compiling, generation must not overlap multi-core benchmarks.
+    machine_lock generate_lock(machine_lock::mode::shared);
+    auto start = std::chrono::steady_clock::now();
+    int exit_code = std::system(command.c_str());
+    generate_lock.unlock();
+    double seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start).count();
+    metrics.artifact_seconds.observe(seconds);
+    bool ok = WEXITSTATUS(exit_code) == 0;
+    if (ok) {
+      for (const char *artifact : display_artifacts) {
+        ok = ok && store.put_file(record, artifact, dir / artifact);
+      }
+      ok = ok &&
+           store.put(record, "artifact_seconds", std::to_string(seconds)) &&
+           store.write_record(task, submission_id, record);
+    }
+    std::filesystem::remove_all(dir);
+    std::printf("Artifacts of %s/%s: %s in %.3f s, kept off the submit path.\n",
+                task.c_str(), submission_id.c_str(),
+                ok ? "generated" : "failed", seconds);
+    return ok;
+  }
+
+  std::mutex mutex;
+  std::map<std::string, std::shared_future<bool>> in_flight;
+  // Submissions whose generation failed, and when.
+  std::map<std::string, std::chrono::steady_clock::time_point> failed;
+};
+
+// Submission ids are generated as "%04d-%04x". Ids from requests are checked
+// against that before any path is built from them.
+bool valid_submission_id(const std::string &id) {
+  size_t dash = id.find('-');
+  if (dash == std::string::npos || dash < 4 || id.size() != dash + 5) {
+    return false;
+  }
+  for (size_t i = 0; i < id.size(); ++i) {
+    char ch = id[i];
+    bool ok = i < dash ? (ch >= '0' && ch <= '9')
+              : i > dash ? ((ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'f'))
+                         : true;
+    if (!ok) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// With stream_large_fields, fields that are stored in a file of their own are
+// only located, not read; see submission_result::files.
 submission_result load_submission_result(const std::string &task,
-                                         const std::string &submission_id) {
+                                         const std::string &submission_id,
+                                         bool stream_large_fields = false) {
   submission_result result;
-  std::filesystem::path submission_dir = "submissions";
-  submission_dir /= task;
-  submission_dir /= submission_id;
-  if (!std::filesystem::exists(submission_dir)) {
+  if (!valid_submission_id(submission_id)) {
     result.found = false;
     return result;
   }
+  submission_record record;
+  bool has_record = store.read_record(task, submission_id, record);
+  // Submissions from before the artifact store are a directory with one file
+  // per record field.
+  std::filesystem::path legacy_dir = "submissions";
+  legacy_dir /= task;
+  legacy_dir /= submission_id;
+  if (!has_record && !std::filesystem::is_directory(legacy_dir)) {
+    result.found = false;
+    return result;
+  }
+  auto field = [&](const std::string &name) {
+    if (has_record) {
+      return strip_newlines(store.get(record, name));
+    }
+    return read_file(legacy_dir / name);
+  };
+  auto large_field = [&](const std::string &name, const std::string &key) {
+    if (stream_large_fields) {
+      std::filesystem::path file =
+          has_record ? store.blob_file(record, name) : legacy_dir / name;
+      if (!file.empty() && std::filesystem::exists(file)) {
+        result.files[key] = file;
+        return std::string();
+      }
+    }
+    return field(name);
+  };
 
   result.found = true;
 
-  result.code = read_file(submission_dir / "submitted_code.highlight.html");
-  if (result.code.empty()) {
-    result.code = read_file(submission_dir / "submitted_code.hpp");
+  result.code = large_field("submitted_code.highlight.html", "code");
+  if (result.code.empty() && !result.files.count("code")) {
+    result.code = large_field("submitted_code.hpp", "code");
   }
-  result.flags = read_file(submission_dir / "flags.txt");
-  result.user_id = read_file(submission_dir / "user_id");
-  result.author = read_file(submission_dir / "author");
+  result.flags = field("flags.txt");
+  result.user_id = field("user_id");
+  result.author = field("author");
   result.submission_id = submission_id;
   result.task = task;
-  result.compiler_output =
-      read_file(submission_dir / "compile_stderr.log.html");
-  result.status = std::atoi(read_file(submission_dir / "exit_code").c_str());
-  result.benchmark_output = read_file(submission_dir / "benchmark_output");
+  result.compiler_output = large_field("compile_stderr.log.html", "compiler_output");
+  result.status = std::atoi(field("exit_code").c_str());
+  result.benchmark_output = large_field("benchmark_output", "benchmark_output");
+  std::string usage = field("rusage");
+  if (!usage.empty()) {
+    result.has_usage = true;
+    result.usage = benchmark_usage::from_text(usage);
+  }
+  std::string compile_seconds = field("compile_seconds");
+  if (!compile_seconds.empty()) {
+    result.compile_seconds = std::atof(compile_seconds.c_str());
+  }
+  std::string artifact_seconds = field("artifact_seconds");
+  if (!artifact_seconds.empty()) {
+    result.artifact_seconds = std::atof(artifact_seconds.c_str());
+  }
+  result.epoch = std::atoi(field("task_epoch").c_str());
+  std::string calibration = field("calibration");
+  if (!calibration.empty()) {
+    result.has_calibration = true;
+    result.calibration = calibration_pair::from_text(calibration);
+  }
 
   if (result.status != 1) {  // not failed
     result.compile_successful = true;
-    result.disassembly = read_file(submission_dir / "disassembly.html");
-    result.disassembly_with_source =
-        read_file(submission_dir / "disassembly_with_source.html");
+    result.disassembly = large_field("disassembly.html", "disassembly");
+    result.disassembly_with_source = large_field("disassembly_with_source.html", "disassembly_with_source");
 
     if (result.status == 0) {
       result.correctness_test_passed = true;
-      std::string content = read_file(submission_dir / "best_time.txt");
+      std::string content = field("best_time.txt");
       std::stringstream ss(content);
       ss >> result.best_time;
       ss >> result.cycles_per_call;
+      std::string key;
+      while (ss >> key) {
+        submission_result::scaling_point p;
+        if (key == "scaling" &&
+            ss >> p.threads >> p.best_time >> p.throughput >> p.efficiency) {
+          result.scaling.push_back(p);
+        }
+      }
+      if (result.has_calibration && result.calibration.mean() > 0.0) {
+        result.normalized_time = result.best_time * calibration_reference /
+                                 result.calibration.mean();
+      }
     } else if (result.status == 2) {
       result.correctness_test_passed = false;
     }
@@ -264,6 +670,21 @@ std::string replace_all(std::string str, const std::string &from,
   return str;
 }
 
+std::string escape_html(const std::string &str) {
+  std::string r;
+  r.reserve(str.size());
+  for (char c : str) {
+    switch (c) {
+      case '<': r += "&lt;"; break;
+      case '>': r += "&gt;"; break;
+      case '&': r += "&amp;"; break;
+      case '"': r += "&quot;"; break;
+      default: r += c;
+    }
+  }
+  return r;
+}
+
 std::string pre(const std::string &str) { return "<pre>" + str + "</pre>"; }
 std::string green(const std::string &str) {
   return "<span style='color:green;'>" + str + "</span>";
@@ -284,12 +705,57 @@ std::string format_time(float time) {
   return std::string(buf);
 }
 
+std::string format_normalized_time(double time) {
+  if (std::isnan(time)) {
+    return "-";
+  }
+  return format_time(time);
+}
+
+std::string format_calibration(const calibration_pair &c) {
+  char buf[256];
+  std::snprintf(buf, sizeof(buf),
+                "before %.3f ms, after %.3f ms, drift %.2f%%",
+                c.before.total() * 1e3, c.after.total() * 1e3,
+                c.drift() * 100);
+  return std::string(buf);
+}
+
+std::string format_status(int status) {
+  switch (status) {
+    case 0: return green("Success");
+    case 1: return red("Compile failed");
+    case 2: return red("Failed");
+    case 4: return red("Timeout");
+    case 5: return red("Rejected: machine state drifted during the run");
+    default: return red("Unknown");
+  }
+}
+
 std::string format_cycles_per_call(float cycles_per_call) {
   char buf[100];
   sprintf(buf, "%.3f cycles/call", cycles_per_call);
   return std::string(buf);
 }
 
+std::string format_usage(const benchmark_usage &u) {
+  char buf[512];
+  std::snprintf(buf, sizeof(buf),
+                "%.3f s user, %.3f s sys, %.3f s wall<br/>"
+                "max RSS %ld KiB<br/>"
+                "context switches: %ld voluntary, %ld involuntary<br/>"
+                "page faults: %ld major, %ld minor<br/>"
+                "attempts: %d",
+                u.user_time, u.system_time, u.wall_time, u.max_rss_kb,
+                u.voluntary_switches, u.involuntary_switches, u.major_faults,
+                u.minor_faults, u.attempts);
+  std::string r(buf);
+  if (u.noisy) {
+    r += " " + red("(noisy)");
+  }
+  return r;
+}
+
 std::string format_author(const std::string &auth, bool text, bool icon) {
   std::string r;
   if (icon) {
@@ -327,15 +793,83 @@ std::string anonimify(std::string input, const std::string &task) {
   return std::string(buf);
 }
 
+std::string user_cell(const std::string &user_id, const std::string &task) {
+  char buf[12];
+  std::hash<std::string> hasher;
+  size_t hash = hasher(user_id);
+  std::sprintf(buf, "#%02zx%02zx%02zx", hash & 0x7f, (hash >> 8) & 0x7f,
+               (hash >> 16) & 0x7f);
+  std::string color(buf);
+  return "<td style='background-color: " + color + "; color: white;'>" +
+         anonimify(user_id, task) + "</td>";
+}
+
+std::string submission_link(const leaderboard_entry &e,
+                            const std::string &user_id, bool public_mode) {
+  if (user_id == e.user_id || public_mode) {
+    return "<a href='view_submission?id=" + e.submission_id + "'>" +
+           e.submission_id + "</a>";
+  }
+  return e.submission_id;
+}
+
+// Table of the latest background re-measurement, ranked by re-measured time,
+// with the rank each entry has on the live leaderboard.
+std::string render_remeasured(const std::string &task,
+                              const std::vector<leaderboard_entry> &remeasured,
+                              std::time_t remeasured_at,
+                              const std::vector<leaderboard_entry> &live,
+                              const std::string &user_id, bool public_mode) {
+  if (remeasured.empty()) {
+    return "";
+  }
+  char when[64];
+  std::strftime(when, sizeof(when), "%Y-%m-%d %H:%M",
+                std::localtime(&remeasured_at));
+  std::string html = "<div>\n";
+  html += "<h2>Re-measured ranking (" + std::string(when) + ")</h2>\n";
+  html += "<p>The top entries, re-run back to back and interleaved under identical conditions.</p>\n";
+  html += "<table style='width: 90%; border-collapse: collapse; max-width: 900px;'>\n";
+  html += "<tr><th>Rank</th><th>Live Rank</th><th>Submission ID</th>"
+          "<th>User ID</th><th>Time</th><th>Cycles / Call</th></tr>\n";
+  for (size_t i = 0; i < remeasured.size(); ++i) {
+    const leaderboard_entry &e = remeasured[i];
+    auto live_it = std::find_if(live.begin(), live.end(), [&](const auto &l) {
+      return l.submission_id == e.submission_id;
+    });
+    std::string live_rank =
+        live_it == live.end() ? "" : std::to_string(live_it - live.begin());
+    if (user_id == e.user_id) {
+      html += "<tr style='background-color: #caddb7;'>";
+    } else {
+      html += "<tr>";
+    }
+    html += "<td>" + std::to_string(i) + "</td>";
+    html += "<td>" + live_rank + "</td>";
+    html += "<td>" + submission_link(e, user_id, public_mode) + "</td>";
+    html += user_cell(e.user_id, task);
+    html += "<td>" + format_time(e.best_time) + "</td>";
+    html += "<td>" + format_cycles_per_call(e.cycles_per_call) + "</td>";
+    html += "</tr>\n";
+  }
+  html += "</table>\n";
+  html += "</div>\n";
+  return html;
+}
+
+// Renders the first `top` entries (all of them when top is 0).
 std::string render_leaderboard(std::string task,
                                const std::vector<leaderboard_entry> &entries,
-                               const std::string &user_id, bool public_mode) {
+                               size_t top, const std::string &user_id,
+                               bool public_mode,
+                               const std::string &remeasured_html) {
   std::string html = read_file("runtime/templates/leaderboard.html");
   html = replace_all(html, "${TASK}", task);
+  size_t shown = top == 0 ? entries.size() : std::min(top, entries.size());
   std::string rows = "";
   std::set<std::string> users_on_leaderboard;
   int user_rank = -1;
-  for (size_t i = 0; i < entries.size(); ++i) {
+  for (size_t i = 0; i < shown; ++i) {
     const leaderboard_entry &e = entries[i];
     auto [it, done] = users_on_leaderboard.insert(e.user_id);
     std::string class_str = "";
@@ -355,166 +889,503 @@ std::string render_leaderboard(std::string task,
     } else {
       rows += "<td></td>";
     }
-    if (user_id == e.user_id || public_mode) {
-      rows += "<td><a href='view_submission?id=" + e.submission_id + "'>" +
-              e.submission_id + "</a></td>";
-    } else {
-      rows += "<td>" + e.submission_id + "</td>";
-    }
-    char buf[12];
-    std::hash<std::string> hasher;
-    size_t hash = hasher(e.user_id);
-    std::sprintf(buf, "#%02zx%02zx%02zx", hash & 0x7f, (hash >> 8) & 0x7f,
-                 (hash >> 16) & 0x7f);
-    std::string color(buf);
-    rows += "<td style='background-color: " + color + "; color: white;'>" +
-            anonimify(e.user_id, task) + "</td>";
+    rows += "<td>" + submission_link(e, user_id, public_mode) + "</td>";
+    rows += user_cell(e.user_id, task);
     rows += "<td>" + format_time(e.best_time) + "</td>";
+    rows += "<td>" + format_normalized_time(e.normalized_time) + "</td>";
     rows += "<td>" + format_cycles_per_call(e.cycles_per_call) + "</td>";
     rows += "<td>" + format_author(e.author, false, true) + "</td>";
     rows += "</tr>\n";
   }
   html = replace_all(html, "${LEADERBOARD_ROWS}", rows);
+  std::string more = "";
+  if (shown < entries.size()) {
+    more = "<p>Showing the top " + std::to_string(shown) + " of " +
+           std::to_string(entries.size()) +
+           " submissions. <a href='?all=1'>Show all</a></p>";
+  }
+  html = replace_all(html, "${MORE_ENTRIES}", more);
+  html = replace_all(html, "${REMEASURED}", remeasured_html);
+  return html;
+}
+
+// Throughput and parallel efficiency per thread count, as a table next to a
+// plot of the speedup against the ideal linear speedup.
+std::string render_scaling(const submission_result &result) {
+  if (result.scaling.empty()) {
+    return "";
+  }
+  const auto &points = result.scaling;
+  std::string html = "<h2>Multi-core scaling</h2>\n<table>\n";
+  html += "<tr><th>Threads</th><th>Best Time</th><th>Elements / s</th>"
+          "<th>Speedup</th><th>Parallel Efficiency</th></tr>\n";
+  double base = points.front().throughput;
+  for (const auto &p : points) {
+    char buf[256];
+    std::snprintf(buf, sizeof(buf),
+                  "<tr><td>%d</td><td>%s</td><td>%.3e</td><td>%.2fx</td>"
+                  "<td>%.1f%%</td></tr>\n",
+                  p.threads, format_time(p.best_time).c_str(), p.throughput,
+                  p.throughput / base, p.efficiency * 100);
+    html += buf;
+  }
+  html += "</table>\n";
+
+  int max_threads = points.back().threads;
+  double max_speedup = max_threads;
+  for (const auto &p : points) {
+    max_speedup = std::max(max_speedup, p.throughput / base);
+  }
+  const int size = 300, margin = 30;
+  auto x = [&](double threads) {
+    return margin + (size - 2 * margin) * (threads - 1) /
+                        std::max(1.0, double(max_threads - 1));
+  };
+  auto y = [&](double speedup) {
+    return size - margin - (size - 2 * margin) * (speedup - 1) /
+                               std::max(1.0, max_speedup - 1);
+  };
+  char buf[256];
+  html += "<svg width='" + std::to_string(size) + "' height='" +
+          std::to_string(size) + "' style='background-color: #f8f8f8;'>\n";
+  std::snprintf(buf, sizeof(buf),
+                "<line x1='%.1f' y1='%.1f' x2='%.1f' y2='%.1f' "
+                "stroke='#aaa' stroke-dasharray='4'/>\n",
+                x(1), y(1), x(max_threads), y(max_threads));
+  html += buf;
+  std::string polyline;
+  for (const auto &p : points) {
+    std::snprintf(buf, sizeof(buf), "%.1f,%.1f ", x(p.threads),
+                  y(p.throughput / base));
+    polyline += buf;
+    std::snprintf(buf, sizeof(buf),
+                  "<circle cx='%.1f' cy='%.1f' r='3' fill='#2471a3'/>\n",
+                  x(p.threads), y(p.throughput / base));
+    html += buf;
+  }
+  html += "<polyline points='" + polyline +
+          "' fill='none' stroke='#2471a3' stroke-width='2'/>\n";
+  html += "<text x='5' y='15'>speedup</text>\n";
+  html += "<text x='" + std::to_string(size - 5) + "' y='" +
+          std::to_string(size - 8) + "' text-anchor='end'>threads (1-" +
+          std::to_string(max_threads) + ")</text>\n";
+  html += "</svg>\n";
   return html;
 }
 
-std::string render_submission_result(const submission_result &result) {
-  std::string html = read_file("runtime/templates/submission_result.html");
+std::string format_pipeline_timing(const submission_result &result) {
+  if (result.compile_seconds < 0) {
+    return "-";
+  }
+  char buf[200];
+  if (result.artifact_seconds < 0) {
+    std::snprintf(buf, sizeof(buf), "compile %.2f s", result.compile_seconds);
+  } else {
+    std::snprintf(buf, sizeof(buf),
+                  "compile %.2f s, disassembly and highlighting %.2f s "
+                  "(generated on first view, not before the benchmark)",
+                  result.compile_seconds, result.artifact_seconds);
+  }
+  return buf;
+}
+
+// The view page as a stream: template literals come from the cached template,
+// file-backed fields are streamed from their files.
+response_stream stream_submission_result(const submission_result &result) {
+  // clang-format off
+  std::map<std::string, std::string> values = {
+    {"TASK", result.task},
+    {"USER_ID", anonimify(result.user_id, result.task)},
+    {"SUBMISSION_ID", result.submission_id},
+    {"COMPILER_FLAGS", result.flags},
+    {"COMPILE_STATUS", result.compile_successful ? green("Success") : red("Failed")},
+    {"CORRECTNESS_TEST", result.correctness_test_passed ? green("Success") : red("Failed")},
+    {"BENCHMARK_BEST_TIME", format_time(result.best_time)},
+    {"BENCHMARK_CYCLES_PER_CALL", format_cycles_per_call(result.cycles_per_call)},
+    {"BENCHMARK_STATUS", format_status(result.status)},
+    {"BENCHMARK_NORMALIZED_TIME", format_normalized_time(result.normalized_time)},
+    {"BENCHMARK_CALIBRATION", result.has_calibration ? format_calibration(result.calibration) : "-"},
+    {"BENCHMARK_RUSAGE", result.has_usage ? format_usage(result.usage) : ""},
+    {"PIPELINE_TIMING", format_pipeline_timing(result)},
+    {"AI_GENERATED", format_author(result.author, true, true)},
+    {"INPUT_CODE", result.code},
+    {"COMPILER_OUTPUT", result.compiler_output},
+    {"DISASSEMBLY", result.disassembly},
+    {"DISASSEMBLY_WITH_SOURCE", result.disassembly_with_source},
+    {"BENCHMARK_OUTPUT", result.benchmark_output},
+    {"SCALING", render_scaling(result)},
+  };
+  static const std::map<std::string, std::string> file_fields = {
+    {"INPUT_CODE", "code"},
+    {"COMPILER_OUTPUT", "compiler_output"},
+    {"DISASSEMBLY", "disassembly"},
+    {"DISASSEMBLY_WITH_SOURCE", "disassembly_with_source"},
+    {"BENCHMARK_OUTPUT", "benchmark_output"},
+  };
+  // clang-format on
+  response_stream stream;
+  template_ptr page = load_template("runtime/templates/submission_result.html");
+  for (const template_segment &segment : *page) {
+    stream.append(segment.literal);
+    if (segment.placeholder.empty()) {
+      continue;
+    }
+    auto file_field = file_fields.find(segment.placeholder);
+    if (file_field != file_fields.end() &&
+        result.files.count(file_field->second)) {
+      stream.append_file(result.files.at(file_field->second));
+      continue;
+    }
+    auto value = values.find(segment.placeholder);
+    if (value != values.end()) {
+      stream.append(value->second);
+    } else {
+      stream.append("${" + segment.placeholder + "}");
+    }
+  }
+  return stream;
+}
+
+// Strip plot of both timing distributions on a shared axis.
+std::string render_distribution_svg(const std::vector<double> &a,
+                                    const std::vector<double> &b) {
+  if (a.empty() || b.empty()) {
+    return "";
+  }
+  double lo = std::min(*std::min_element(a.begin(), a.end()),
+                       *std::min_element(b.begin(), b.end()));
+  double hi = std::max(*std::max_element(a.begin(), a.end()),
+                       *std::max_element(b.begin(), b.end()));
+  double range = hi > lo ? hi - lo : 1.0;
+  const int width = 600, left = 30, plot = 540;
+  std::string svg = "<svg width='" + std::to_string(width) +
+                    "' height='110' style='background-color: #f8f8f8;'>\n";
+  auto row = [&](const std::vector<double> &samples, int y,
+                 const std::string &label, const std::string &color) {
+    svg += "<text x='5' y='" + std::to_string(y + 4) + "'>" + label +
+           "</text>\n";
+    for (size_t i = 0; i < samples.size(); ++i) {
+      double x = left + plot * (samples[i] - lo) / range;
+      int jitter = int(i % 7) * 2 - 6;
+      char buf[160];
+      std::snprintf(buf, sizeof(buf),
+                    "<circle cx='%.1f' cy='%d' r='3' fill='%s' "
+                    "fill-opacity='0.6'/>\n",
+                    x, y + jitter, color.c_str());
+      svg += buf;
+    }
+  };
+  row(a, 25, "A", "#c0392b");
+  row(b, 60, "B", "#2471a3");
+  svg += "<text x='" + std::to_string(left) + "' y='100'>" + format_time(lo) +
+         "</text>\n";
+  svg += "<text x='" + std::to_string(left + plot) +
+         "' y='100' text-anchor='end'>" + format_time(hi) + "</text>\n";
+  svg += "</svg>";
+  return svg;
+}
+
+// Side-by-side disassembly, aligned by basic block.
+std::string render_disassembly_diff(const std::string &a_html,
+                                    const std::string &b_html) {
+  std::vector<basic_block> a = split_basic_blocks(strip_html(a_html));
+  std::vector<basic_block> b = split_basic_blocks(strip_html(b_html));
+  auto block_text = [](const basic_block &block) {
+    std::string text;
+    for (const std::string &line : block.lines) {
+      text += escape_html(line) + "\n";
+    }
+    return text;
+  };
+  std::string html = "<table class='diff'>\n";
+  for (auto [i, j] : align_basic_blocks(a, b)) {
+    std::string cls = "changed";
+    if (i < 0) {
+      cls = "added";
+    } else if (j < 0) {
+      cls = "removed";
+    } else if (a[i].key == b[j].key) {
+      cls = "same";
+    }
+    html += "<tr class='" + cls + "'>";
+    html += "<td><pre>" + (i >= 0 ? block_text(a[i]) : "") + "</pre></td>";
+    html += "<td><pre>" + (j >= 0 ? block_text(b[j]) : "") + "</pre></td>";
+    html += "</tr>\n";
+  }
+  html += "</table>";
+  return html;
+}
+
+std::string format_summary_row(const std::string &label,
+                               const submission_result &r,
+                               const sample_summary &s) {
+  std::string row = "<tr><td>" + label + "</td>";
+  row += "<td><a href='view_submission?id=" + r.submission_id + "'>" +
+         r.submission_id + "</a></td>";
+  row += "<td><code>" + r.flags + "</code></td>";
+  row += "<td>" + std::to_string(s.count) + "</td>";
+  row += "<td>" + format_time(s.min) + "</td>";
+  row += "<td>" + format_time(s.median) + "</td>";
+  row += "<td>" + format_time(s.mean) + " &plusmn; " + format_time(s.stddev) +
+         "</td>";
+  row += "<td>" + format_cycles_per_call(r.cycles_per_call) + "</td>";
+  row += "</tr>\n";
+  return row;
+}
+
+// Where the samples on the comparison page come from.
+enum class comparison_samples { original, rerun_queued, rerun_failed, rerun };
+
+std::string render_comparison(const submission_result &a,
+                              const submission_result &b,
+                              const std::vector<double> &samples_a,
+                              const std::vector<double> &samples_b,
+                              comparison_samples source, bool can_rerun) {
+  sample_comparison c = compare_samples(samples_a, samples_b);
+  std::string html = read_file("runtime/templates/compare.html");
+  char buf[256];
+  std::snprintf(buf, sizeof(buf), "%.4fx", c.speedup);
+  std::string speedup(buf);
+  std::snprintf(buf, sizeof(buf), "[%.4fx, %.4fx]", c.speedup_low,
+                c.speedup_high);
+  std::string speedup_ci(buf);
+  std::snprintf(buf, sizeof(buf), "U = %.1f, p = %.3g", c.u, c.p_value);
+  std::string test(buf);
+
+  std::string verdict;
+  bool enough = c.a.count >= 20 && c.b.count >= 20;
+  if (!enough) {
+    verdict = red("Not enough samples to tell.");
+  } else if (!c.significant()) {
+    verdict = red("No significant difference.");
+  } else if (c.speedup > 1) {
+    verdict = green("B is faster than A.");
+  } else {
+    verdict = green("A is faster than B.");
+  }
+  std::string rerun_html;
+  if (source == comparison_samples::rerun) {
+    rerun_html = "Samples come from a paired, interleaved re-run of both binaries.";
+  } else if (source == comparison_samples::rerun_queued) {
+    rerun_html = "Samples come from the original submission runs. A paired "
+                 "re-run is queued behind the submissions; reload this page "
+                 "later.";
+  } else {
+    rerun_html = "Samples come from the original submission runs. ";
+    if (source == comparison_samples::rerun_failed) {
+      rerun_html += "The last paired re-run failed. ";
+    }
+    if (can_rerun && (!enough || !c.significant())) {
+      rerun_html += "<form method='post' action='compare_rerun' style='display:inline'>"
+                    "<input type='hidden' name='a' value='" + a.submission_id + "'>"
+                    "<input type='hidden' name='b' value='" + b.submission_id + "'>"
+                    "<input type='submit' value='Re-run both interleaved for more samples'>"
+                    "</form>";
+    }
+  }
+
   // clang-format off
-  html = replace_all(html, "${TASK}", result.task);
-  html = replace_all(html, "${USER_ID}", anonimify(result.user_id, result.task));
-  html = replace_all(html, "${SUBMISSION_ID}", result.submission_id);
-  html = replace_all(html, "${COMPILER_FLAGS}", result.flags);
-  html = replace_all(html, "${COMPILE_STATUS}", result.compile_successful ? green("Success") : red("Failed"));
-  html = replace_all(html, "${CORRECTNESS_TEST}", result.correctness_test_passed ? green("Success") : red("Failed"));
-  html = replace_all(html, "${BENCHMARK_BEST_TIME}", format_time(result.best_time));
-  html = replace_all(html, "${BENCHMARK_CYCLES_PER_CALL}", format_cycles_per_call(result.cycles_per_call));
-  html = replace_all(html, "${AI_GENERATED}", format_author(result.author, true, true));
-  html = replace_all(html, "${INPUT_CODE}", result.code);
-  html = replace_all(html, "${COMPILER_OUTPUT}", result.compiler_output);
-  html = replace_all(html, "${DISASSEMBLY}", result.disassembly);
-  html = replace_all(html, "${DISASSEMBLY_WITH_SOURCE}", result.disassembly_with_source);
-  html = replace_all(html, "${BENCHMARK_OUTPUT}", result.benchmark_output);
+  html = replace_all(html, "${TASK}", a.task);
+  html = replace_all(html, "${A}", a.submission_id);
+  html = replace_all(html, "${B}", b.submission_id);
+  html = replace_all(html, "${SUMMARY_ROWS}", format_summary_row("A", a, c.a) + format_summary_row("B", b, c.b));
+  html = replace_all(html, "${SPEEDUP}", speedup);
+  html = replace_all(html, "${SPEEDUP_CI}", speedup_ci);
+  html = replace_all(html, "${SIGNIFICANCE_TEST}", test);
+  html = replace_all(html, "${VERDICT}", verdict);
+  html = replace_all(html, "${SAMPLES_SOURCE}", rerun_html);
+  html = replace_all(html, "${DISTRIBUTION}", render_distribution_svg(samples_a, samples_b));
+  html = replace_all(html, "${DISASSEMBLY_DIFF}", render_disassembly_diff(a.disassembly, b.disassembly));
   // clang-format on
   return html;
 }
 
-static int submission_id_counter = 0;
+static std::atomic<int> submission_id_counter{0};
 std::string generate_submission_id() {
   char buf[100];
-  submission_id_counter++;
+  int id = ++submission_id_counter;
   int rand_val = std::rand() % 0xffff;
-  std::sprintf(buf, "%04d-%04x", submission_id_counter, rand_val);
+  std::sprintf(buf, "%04d-%04x", id, rand_val);
   return std::string(buf);
 }
 
-void sort_leaderboard(std::vector<leaderboard_entry> &leaderboard) {
-  std::sort(leaderboard.begin(), leaderboard.end(),
-            [](auto &a, auto &b) { return a.best_time < b.best_time; });
+// Opaque pagination cursor: the position of the last returned entry in the
+// leaderboard order, "<best_time bits in hex>~<submission id>".
+std::string encode_leaderboard_cursor(const leaderboard_entry &e) {
+  uint64_t bits;
+  std::memcpy(&bits, &e.best_time, sizeof(bits));
+  char buf[20];
+  std::snprintf(buf, sizeof(buf), "%016" PRIx64, bits);
+  return std::string(buf) + "~" + e.submission_id;
 }
 
-std::string generate_user_id() {
-  char buf[100];
-  submission_id_counter++;
-  int32_t rand_val = std::rand();
-  std::sprintf(buf, "%08x", rand_val);
-  return std::string(buf);
+bool decode_leaderboard_cursor(const std::string &cursor,
+                               leaderboard_entry &position) {
+  size_t sep = cursor.find('~');
+  if (sep != 16) {
+    return false;
+  }
+  char *end = nullptr;
+  uint64_t bits = std::strtoull(cursor.substr(0, sep).c_str(), &end, 16);
+  if (*end != '\0') {
+    return false;
+  }
+  std::memcpy(&position.best_time, &bits, sizeof(bits));
+  position.submission_id = cursor.substr(sep + 1);
+  return true;
 }
 
-std::string find_user_id_in_request(const httplib::Request &req) {
-  static std::string header{"Cookie"};
-  int count = req.get_header_value_count(header);
-  for (int i = 0; i < count; ++i) {
-    std::string cookie_str = req.get_header_value(header, i);
-    int offset = 0;
-    while (true) {
-      int cookie_end = cookie_str.find("; ", offset);
-      std::string cookie;
-      if (cookie_end == std::string::npos) {
-        cookie = cookie_str.substr(offset, cookie_end - offset);
-      }
-      int space_idx = cookie.find("=");
-      if (space_idx != std::string::npos) {
-        std::string cookie_name = cookie.substr(0, space_idx);
-        std::string cookie_value = cookie.substr(space_idx + 1);
-        if (cookie_name == "userId") {
-          return cookie_value;
-        }
-      }
-
-      if (cookie_end == std::string::npos) {
-        break;
-      } else {
-        offset = cookie_end + 2;
-      }
+// One page of the leaderboard as JSON. mode "all" pages through every entry,
+// "user_best" through the best entry of each user. `top` caps the ranks that
+// can be returned at all, `limit` the entries per page; the page starts after
+// `cursor`, or at rank 0 when it is empty. Returns false on invalid arguments.
+bool leaderboard_page_json(const std::string &task,
+                           const leaderboard_snapshot &snapshot,
+                           const std::string &mode, size_t top, size_t limit,
+                           const std::string &cursor,
+                           const std::string &user_id, nlohmann::json &page) {
+  const std::vector<leaderboard_entry> *entries;
+  if (mode == "" || mode == "all") {
+    entries = &snapshot.entries;
+  } else if (mode == "user_best") {
+    entries = &snapshot.user_best;
+  } else {
+    return false;
+  }
+  size_t begin = 0;
+  if (!cursor.empty()) {
+    leaderboard_entry position;
+    if (!decode_leaderboard_cursor(cursor, position)) {
+      return false;
     }
+    begin = std::upper_bound(entries->begin(), entries->end(), position,
+                             leaderboard_order) -
+            entries->begin();
   }
-  return "";
-}
-
-int main(int argc, char **argv) {
-  // clang-format off
-  cxxopts::Options options("ClassroomPerf", "Classroom performance competition");
-  options.add_options()
-    ("task", "The task name for this competition.", cxxopts::value<std::string>())
-    ("host", "Bind address for the server.", cxxopts::value<std::string>()->default_value("0.0.0.0"))
-    ("port", "Bind port for the server.", cxxopts::value<int>()->default_value("5000"))
-    ("P,public", "Run the server publicly.")
-    ("R,regenerate-leaderboard", "Regenerate the leaderboard from the submission folder.")
-    ;
-  options.parse_positional({"task"});
-  // clang-format on
-
-  auto args = options.parse(argc, argv);
-  if (args.count("help") || args.count("task") == 0) {
-    std::cout << options.help() << std::endl;
-    std::exit(0);
+  size_t total = entries->size();
+  if (top > 0) {
+    total = std::min(total, top);
   }
+  size_t end = std::min(total, begin + limit);
+
+  page = nlohmann::json::object();
+  page["task"] = task;
+  page["mode"] = entries == &snapshot.entries ? "all" : "user_best";
+  page["total"] = total;
+  nlohmann::json rows = nlohmann::json::array();
+  for (size_t i = begin; i < end; ++i) {
+    const leaderboard_entry &e = (*entries)[i];
+    nlohmann::json row;
+    row["rank"] = i;
+    row["submission_id"] = e.submission_id;
+    row["user"] = anonimify(e.user_id, task);
+    row["best_time"] = e.best_time;
+    row["cycles_per_call"] = e.cycles_per_call;
+    row["normalized_time"] = std::isnan(e.normalized_time)
+                                 ? nlohmann::json(nullptr)
+                                 : nlohmann::json(e.normalized_time);
+    row["author"] = e.author;
+    row["is_you"] = !user_id.empty() && e.user_id == user_id;
+    rows.push_back(std::move(row));
+  }
+  page["entries"] = std::move(rows);
+  page["next_cursor"] = end < total
+                            ? nlohmann::json(encode_leaderboard_cursor(
+                                  (*entries)[end - 1]))
+                            : nlohmann::json(nullptr);
+  return true;
+}
 
-  std::string task = args["task"].as<std::string>();
-  bool public_mode = args["public"].count();
+// Everything the server knows about one directory under tasks/.
+struct task_config {
+  std::string name;
+  std::filesystem::path folder;
+  std::string symbol;
+  std::string signature;
+  // "scaling": the harness runs the kernel on all cores, so the benchmark is
+  // not pinned to the benchmark core.
+  std::string mode;
+  std::string compile_flags;  // appended to the student's flags
+  std::string dataset;        // dataset spec, see dataset.hpp
+  // Contents of tasks/<task>/epoch (0 if absent). Bumped when the harness or
+  // its inputs change so that times are no longer comparable: the leaderboard
+  // only ranks submissions of the current epoch.
+  int epoch{0};
+  std::vector<std::string> bad_code_regex;
+  leaderboard_store leaderboard;
+  // Latest background re-measurement of the top entries.
+  leaderboard_store remeasured;
+  std::atomic<std::time_t> remeasured_at{0};
+};
 
-  std::filesystem::path task_folder("tasks/");
-  task_folder /= task;
-  if (!std::filesystem::is_directory(task_folder)) {
-    std::printf("No task directory found: %s\n", task_folder.c_str());
-    return 1;
-  }
+std::unique_ptr<task_config> load_task(const std::filesystem::path &folder) {
+  auto task = std::make_unique<task_config>();
+  task->name = folder.filename().string();
+  task->folder = folder;
+  std::printf("Loading task %s.\n", task->name.c_str());
 
-  std::filesystem::path bad_code_file = task_folder / "bad_code.regex";
+  std::filesystem::path bad_code_file = folder / "bad_code.regex";
   if (std::filesystem::exists(bad_code_file)) {
-    task_specific_bad_code_regex.clear();
     std::ifstream f(bad_code_file.string());
     if (f.is_open()) {
       std::printf("Found bad code file with rules:\n");
       std::string line;
       while (std::getline(f, line)) {
         if (!line.empty()) {
-          task_specific_bad_code_regex.push_back(line);
+          task->bad_code_regex.push_back(line);
           std::printf("   '%s'\n", line.c_str());
         }
       }
     } else {
-      std::printf("Could not load bad-code file for task %s: %s.\n", task.c_str(), bad_code_file.c_str());
+      std::printf("Could not load bad-code file for task %s: %s.\n",
+                  task->name.c_str(), bad_code_file.c_str());
     }
   } else {
-    std::printf("No bad code file found for task %s.\n", task.c_str());
+    std::printf("No bad code file found for task %s.\n", task->name.c_str());
   }
 
-  std::filesystem::path symbol_file = task_folder / "symbol";
-  std::string symbol;
+  std::filesystem::path symbol_file = folder / "symbol";
   if (std::filesystem::exists(symbol_file)) {
-    symbol = read_file(symbol_file.string());
-    std::printf("Symbol file indicates: %s.\n", symbol.c_str());
+    task->symbol = read_file(symbol_file.string());
+    std::printf("Symbol file indicates: %s.\n", task->symbol.c_str());
   } else {
-    std::printf("No symbol file found for task %s.\n", task.c_str());
-    return 1;
+    std::printf("No symbol file found for task %s.\n", task->name.c_str());
+    return nullptr;
   }
 
+  std::filesystem::path signature_file = folder / "signature";
+  if (std::filesystem::exists(signature_file)) {
+    task->signature = read_file(signature_file.string());
+  } else {
+    task->signature = task->symbol;
+  }
 
+  task->mode = read_file(folder / "mode");
+  if (task->mode.empty()) {
+    task->mode = "single";
+  }
+  task->compile_flags = read_file(folder / "compile_flags");
+  std::printf("Task mode: %s.\n", task->mode.c_str());
+  task->epoch = std::atoi(read_file(folder / "epoch").c_str());
+
+  task->dataset = read_file(folder / "dataset");
+  if (!task->dataset.empty()) {
+    std::filesystem::path dataset = ensure_dataset(task->dataset);
+    if (dataset.empty()) {
+      std::printf("Could not generate dataset '%s' for task %s.\n",
+                  task->dataset.c_str(), task->name.c_str());
+      return nullptr;
+    }
+    std::printf("Dataset: %s.\n", dataset.c_str());
+  }
+  return task;
+}
 
-  std::srand(std::time(0));
-  std::vector<leaderboard_entry> leaderboard;
+// Submissions of other epochs than the given one are left out.
+std::vector<leaderboard_entry> load_leaderboard(const std::string &task,
+                                                int epoch, bool regenerate) {
+  std::vector<leaderboard_entry> entries;
+  size_t other_epochs = 0;
 
   // Create submissions dir
   std::filesystem::path submission_dir = "submissions";
@@ -525,21 +1396,28 @@ int main(int argc, char **argv) {
   std::filesystem::path leaderboard_dir = "leaderboard";
   leaderboard_dir /= task;
   std::filesystem::create_directories(leaderboard_dir);
-  submission_id_counter = 0;
-  if (args.count("regenerate-leaderboard") || !STORE_LEADERBOARD) {
-    std::printf("Regenerating leaderboard...");
+  if (regenerate || !STORE_LEADERBOARD) {
+    std::printf("Regenerating leaderboard for %s...\n", task.c_str());
 
     for (auto it = std::filesystem::directory_iterator(
              submission_dir,
              std::filesystem::directory_options::skip_permission_denied);
          it != std::filesystem::directory_iterator(); ++it) {
+      std::string submission_id;
       if (std::filesystem::is_directory(it->path())) {
+        submission_id = it->path().filename().string();
+      } else if (it->path().extension() == ".rec") {
+        submission_id = it->path().stem().string();
+      }
+      if (!submission_id.empty()) {
         submission_id_counter++;
-        submission_result result =
-            load_submission_result(task, it->path().filename().string());
-        if (result.compile_successful && result.correctness_test_passed) {
+        submission_result result = load_submission_result(task, submission_id);
+        if (result.epoch != epoch) {
+          other_epochs++;
+        } else if (result.compile_successful &&
+                   result.correctness_test_passed) {
           leaderboard_entry e = make_leaderboard_entry(result);
-          leaderboard.push_back(std::move(e));
+          entries.push_back(std::move(e));
         }
       }
     }
@@ -557,28 +1435,778 @@ int main(int argc, char **argv) {
         leaderboard_entry entry;
         js.get_to(entry);
 
-        leaderboard.push_back(std::move(entry));
+        entries.push_back(std::move(entry));
       }
     }
 #endif
   }
-  std::printf("Loaded %zu leaderboard entries.\n", leaderboard.size());
-  sort_leaderboard(leaderboard);
+  std::printf("Loaded %zu leaderboard entries for %s, left out %zu submissions "
+              "of other epochs.\n",
+              entries.size(), task.c_str(), other_epochs);
+  return entries;
+}
+
+// One pool of compile/benchmark workers shared by all hosted tasks. Every task
+// has its own FIFO and idle workers pick tasks round-robin, so a burst of
+// submissions in one class cannot starve the other classes of cores.
+struct submission_scheduler {
+  explicit submission_scheduler(int num_workers) {
+    for (int i = 0; i < num_workers; ++i) {
+      workers.emplace_back([this]() { worker_loop(); });
+    }
+  }
+
+  ~submission_scheduler() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    cv.notify_all();
+    for (std::thread &t : workers) {
+      t.join();
+    }
+  }
+
+  std::future<int> enqueue(const std::string &task, std::function<int()> job) {
+    std::packaged_task<int()> packaged(std::move(job));
+    std::future<int> result = packaged.get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      queues[task].push_back(std::move(packaged));
+      ++pending;
+    }
+    cv.notify_one();
+    return result;
+  }
+
+  size_t queue_depth() const { return pending; }
+  int jobs_in_flight() const { return in_flight; }
+  bool idle() const { return pending == 0 && in_flight == 0; }
+
+ private:
+  // Picks the first non-empty queue after the task served last. Must be
+  // called with the mutex held.
+  bool pop_next(std::packaged_task<int()> &job) {
+    if (queues.empty()) {
+      return false;
+    }
+    auto it = queues.upper_bound(last_task);
+    for (size_t i = 0; i < queues.size(); ++i, ++it) {
+      if (it == queues.end()) {
+        it = queues.begin();
+      }
+      if (!it->second.empty()) {
+        job = std::move(it->second.front());
+        it->second.pop_front();
+        last_task = it->first;
+        --pending;
+        ++in_flight;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void worker_loop() {
+    while (true) {
+      std::packaged_task<int()> job;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [&]() { return stopping || pop_next(job); });
+        if (!job.valid()) {
+          return;
+        }
+      }
+      job();
+      --in_flight;
+    }
+  }
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::map<std::string, std::deque<std::packaged_task<int()>>> queues;
+  std::string last_task;
+  std::atomic<size_t> pending{0};
+  std::atomic<int> in_flight{0};
+  bool stopping{false};
+  std::vector<std::thread> workers;
+};
+
+// Runs the stored binaries of two submissions alternately (ABBA order) on the
+// benchmark core and collects the per-run times of every process. wait_turn is
+// called before every run, which takes the benchmark core only for itself;
+// the re-run is abandoned when it returns false.
+bool paired_rerun(const std::string &task, bool multi_core,
+                  const std::string &dataset, const std::string &a,
+                  const std::string &b, int rounds,
+                  const std::function<bool()> &wait_turn,
+                  std::vector<double> &samples_a,
+                  std::vector<double> &samples_b) {
+  if (!valid_submission_id(a) || !valid_submission_id(b)) {
+    return false;
+  }
+  std::filesystem::path dir = "work";
+  dir /= "compare";
+  dir /= task;
+  dir /= a + "_" + b;
+  std::filesystem::path dirs[2] = {dir / "a", dir / "b"};
+  const std::string *ids[2] = {&a, &b};
+  std::vector<double> *samples[2] = {&samples_a, &samples_b};
+  for (int k = 0; k < 2; ++k) {
+    submission_record record;
+    std::filesystem::create_directories(dirs[k]);
+    if (!store.read_record(task, *ids[k], record) ||
+        !store.extract(record, "benchmark", dirs[k] / "benchmark") ||
+        !link_dataset(dirs[k], dataset)) {
+      std::filesystem::remove_all(dir);
+      return false;
+    }
+    std::filesystem::permissions(dirs[k] / "benchmark",
+                                 std::filesystem::perms::owner_exec,
+                                 std::filesystem::perm_options::add);
+  }
+  samples_a.clear();
+  samples_b.clear();
+  benchmark_policy policy = benchmark_settings;
+  policy.multi_core = multi_core;
+  for (int round = 0; round < rounds; ++round) {
+    for (int step = 0; step < 2; ++step) {
+      int k = step ^ (round & 1);
+      if (!wait_turn()) {
+        std::filesystem::remove_all(dir);
+        return false;
+      }
+      benchmark_core_lock core_lock = lock_benchmark_core(policy);
+      benchmark_run run = run_benchmark_process(dirs[k], policy);
+      core_lock.unlock();
+      if (run.status == 0) {
+        std::vector<double> s = parse_timing_samples(
+            read_file(dirs[k] / "benchmark_output", false));
+        samples[k]->insert(samples[k]->end(), s.begin(), s.end());
+      }
+    }
+  }
+  std::filesystem::remove_all(dir);
+  return true;
+}
+
+// Re-runs the stored binaries of the top leaderboard entries back to back on
+// the benchmark core, so their ranking no longer depends on the load at the
+// time they were submitted. Submissions are run round-robin for several rounds
+// (rotating the starting entry) so slow machine drift affects all of them
+// alike, and each keeps its best time. Before every run the service waits for
+// the submission scheduler to be idle, so it never delays interactive work
+// by more than the one run already in progress. Paired re-runs requested from
+// the comparison page go through the same queue.
+struct remeasure_service {
+  struct request {
+    task_config *task;
+    int top;  // 0: all entries
+    // Set for a paired re-run of two submissions instead of the leaderboard.
+    std::string compare_a;
+    std::string compare_b;
+  };
+
+  // Outcome of a paired re-run, kept for the comparison page.
+  struct comparison {
+    bool done{false};
+    bool ok{false};
+    std::vector<double> samples_a;
+    std::vector<double> samples_b;
+    std::time_t at{0};
+  };
+
+  remeasure_service(submission_scheduler &scheduler, int rounds)
+      : scheduler(scheduler), rounds(std::max(1, rounds)) {
+    thread = std::thread([this]() { loop(); });
+  }
+
+  ~remeasure_service() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    cv.notify_all();
+    thread.join();
+  }
+
+  void enqueue(task_config *task, int top) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      requests.push_back({task, top, "", ""});
+    }
+    cv.notify_all();
+  }
+
+  enum class enqueue_result { queued, pending, full };
+
+  // Queues a paired re-run of submissions a and b, unless the pair is already
+  // queued or running, or every stored comparison is still pending.
+  enqueue_result enqueue_comparison(task_config *task, const std::string &a,
+                                    const std::string &b) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      std::string key = comparison_key(task, a, b);
+      auto it = comparisons.find(key);
+      if (it != comparisons.end() && !it->second.done) {
+        return enqueue_result::pending;
+      }
+      // Only the latest results are kept.
+      while (comparisons.size() >= max_comparisons) {
+        auto oldest = comparisons.end();
+        for (auto c = comparisons.begin(); c != comparisons.end(); ++c) {
+          if (c->second.done &&
+              (oldest == comparisons.end() || c->second.at < oldest->second.at)) {
+            oldest = c;
+          }
+        }
+        if (oldest == comparisons.end()) {
+          return enqueue_result::full;
+        }
+        comparisons.erase(oldest);
+      }
+      comparisons[key] = comparison();
+      requests.push_back({task, 0, a, b});
+    }
+    cv.notify_all();
+    return enqueue_result::queued;
+  }
+
+  // The latest paired re-run of a and b, if one was requested.
+  bool find_comparison(task_config *task, const std::string &a,
+                       const std::string &b, comparison &result) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = comparisons.find(comparison_key(task, a, b));
+    if (it == comparisons.end()) {
+      return false;
+    }
+    result = it->second;
+    return true;
+  }
+
+  // Enqueues the given tasks every interval (if positive).
+  void schedule_periodic(std::vector<task_config *> tasks, int top,
+                         std::chrono::minutes interval) {
+    std::lock_guard<std::mutex> lock(mutex);
+    periodic_tasks = std::move(tasks);
+    periodic_top = top;
+    periodic_interval = interval;
+    next_periodic = std::chrono::steady_clock::now() + interval;
+  }
+
+ private:
+  struct candidate {
+    leaderboard_entry entry;
+    std::filesystem::path dir;
+    bool measured{false};
+  };
+
+  void loop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+      if (periodic_interval.count() > 0 &&
+          std::chrono::steady_clock::now() >= next_periodic) {
+        for (task_config *task : periodic_tasks) {
+          requests.push_back({task, periodic_top, "", ""});
+        }
+        next_periodic = std::chrono::steady_clock::now() + periodic_interval;
+      }
+      if (requests.empty()) {
+        if (periodic_interval.count() > 0) {
+          cv.wait_until(lock, next_periodic);
+        } else {
+          cv.wait(lock);
+        }
+        continue;
+      }
+      request r = requests.front();
+      requests.pop_front();
+      lock.unlock();
+      if (r.compare_a.empty()) {
+        run(r);
+      } else {
+        run_comparison(r);
+      }
+      lock.lock();
+    }
+  }
+
+  // Blocks until no interactive submission is queued or running. Returns false
+  // when the service is shutting down.
+  bool wait_for_idle_scheduler() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping && !scheduler.idle()) {
+      cv.wait_for(lock, std::chrono::milliseconds(200));
+    }
+    return !stopping;
+  }
+
+  static std::string comparison_key(task_config *task, const std::string &a,
+                                    const std::string &b) {
+    return task->name + "/" + a + "/" + b;
+  }
+
+  void run_comparison(const request &r) {
+    task_config *task = r.task;
+    std::printf("Paired re-run of %s and %s of %s.\n", r.compare_a.c_str(),
+                r.compare_b.c_str(), task->name.c_str());
+    comparison c;
+    c.ok = paired_rerun(task->name, task->mode == "scaling", task->dataset,
+                        r.compare_a, r.compare_b, 3,
+                        [this]() { return wait_for_idle_scheduler(); },
+                        c.samples_a, c.samples_b);
+    c.done = true;
+    c.at = std::time(nullptr);
+    std::lock_guard<std::mutex> lock(mutex);
+    comparisons[comparison_key(task, r.compare_a, r.compare_b)] = std::move(c);
+  }
+
+  void run(const request &r) {
+    task_config *task = r.task;
+    leaderboard_store::snapshot_ptr live = task->leaderboard.snapshot();
+    size_t count = live->entries.size();
+    if (r.top > 0) {
+      count = std::min(count, size_t(r.top));
+    }
+    std::printf("Re-measuring top %zu entries of %s over %d rounds.\n", count,
+                task->name.c_str(), rounds);
+    benchmark_policy policy = benchmark_settings;
+    policy.multi_core = task->mode == "scaling";
+
+    std::vector<candidate> candidates;
+    for (size_t i = 0; i < count; ++i) {
+      candidate c;
+      c.entry = live->entries[i];
+      c.entry.best_time = std::numeric_limits<double>::infinity();
+      c.entry.cycles_per_call = std::numeric_limits<double>::infinity();
+      c.dir = "work";
+      c.dir /= "remeasure";
+      c.dir /= task->name;
+      c.dir /= c.entry.submission_id;
+      submission_record record;
+      std::filesystem::create_directories(c.dir);
+      if (!store.read_record(task->name, c.entry.submission_id, record) ||
+          !store.extract(record, "benchmark", c.dir / "benchmark") ||
+          !link_dataset(c.dir, task->dataset)) {
+        std::printf("   - no stored binary for %s, skipped.\n",
+                    c.entry.submission_id.c_str());
+        std::filesystem::remove_all(c.dir);
+        continue;
+      }
+      std::filesystem::permissions(c.dir / "benchmark",
+                                   std::filesystem::perms::owner_exec,
+                                   std::filesystem::perm_options::add);
+      candidates.push_back(std::move(c));
+    }
+
+    for (int round = 0; round < rounds && !candidates.empty(); ++round) {
+      for (size_t k = 0; k < candidates.size(); ++k) {
+        candidate &c = candidates[(k + round) % candidates.size()];
+        if (!wait_for_idle_scheduler()) {
+          return;
+        }
+        benchmark_core_lock core_lock = lock_benchmark_core(policy);
+        benchmark_run run = run_benchmark_process(c.dir, policy);
+        core_lock.unlock();
+        if (run.status != 0) {
+          continue;
+        }
+        std::stringstream ss(read_file(c.dir / "best_time.txt"));
+        double best_time, cycles_per_call;
+        if (ss >> best_time >> cycles_per_call &&
+            best_time < c.entry.best_time) {
+          c.entry.best_time = best_time;
+          c.entry.cycles_per_call = cycles_per_call;
+          c.measured = true;
+        }
+      }
+    }
+
+    std::vector<leaderboard_entry> ranking;
+    for (candidate &c : candidates) {
+      std::filesystem::remove_all(c.dir);
+      if (c.measured) {
+        ranking.push_back(std::move(c.entry));
+      }
+    }
+    std::printf("Re-measured %zu entries of %s.\n", ranking.size(),
+                task->name.c_str());
+    task->remeasured.publish(std::move(ranking));
+    task->remeasured_at = std::time(nullptr);
+  }
+
+  submission_scheduler &scheduler;
+  int rounds;
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::deque<request> requests;
+  static constexpr size_t max_comparisons = 256;
+  std::map<std::string, comparison> comparisons;
+  std::vector<task_config *> periodic_tasks;
+  int periodic_top{0};
+  std::chrono::minutes periodic_interval{0};
+  std::chrono::steady_clock::time_point next_periodic;
+  bool stopping{false};
+  std::thread thread;
+};
+
+std::string generate_user_id() {
+  char buf[100];
+  submission_id_counter++;
+  int32_t rand_val = std::rand();
+  std::sprintf(buf, "%08x", rand_val);
+  return std::string(buf);
+}
+
+std::string find_user_id_in_request(const httplib::Request &req) {
+  static std::string header{"Cookie"};
+  int count = req.get_header_value_count(header);
+  for (int i = 0; i < count; ++i) {
+    std::string cookie_str = req.get_header_value(header, i);
+    int offset = 0;
+    while (true) {
+      int cookie_end = cookie_str.find("; ", offset);
+      std::string cookie;
+      if (cookie_end == std::string::npos) {
+        cookie = cookie_str.substr(offset, cookie_end - offset);
+      }
+      int space_idx = cookie.find("=");
+      if (space_idx != std::string::npos) {
+        std::string cookie_name = cookie.substr(0, space_idx);
+        std::string cookie_value = cookie.substr(space_idx + 1);
+        if (cookie_name == "userId") {
+          return cookie_value;
+        }
+      }
+
+      if (cookie_end == std::string::npos) {
+        break;
+      } else {
+        offset = cookie_end + 2;
+      }
+    }
+  }
+  return "";
+}
+
+std::string render_task_index(
+    const std::map<std::string, std::unique_ptr<task_config>> &tasks) {
+  std::string html = read_file("runtime/templates/index.html");
+  std::string rows = "";
+  for (const auto &[name, task] : tasks) {
+    leaderboard_store::snapshot_ptr entries = task->leaderboard.snapshot();
+    rows += "<tr>";
+    rows += "<td><a href='task/" + name + "/leaderboard'>" + name + "</a></td>";
+    rows += "<td>" + std::to_string(entries->entries.size()) + "</td>";
+    if (!entries->entries.empty()) {
+      rows += "<td>" +
+              format_cycles_per_call(entries->entries.front().cycles_per_call) +
+              "</td>";
+    } else {
+      rows += "<td></td>";
+    }
+    rows += "</tr>\n";
+  }
+  html = replace_all(html, "${TASK_ROWS}", rows);
+  return html;
+}
+
+std::string escape_label_value(const std::string &value) {
+  std::string escaped;
+  for (char c : value) {
+    if (c == '\\' || c == '"') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+// Everything /metrics exports. Reads only atomics and leaderboard snapshots,
+// so it can be scraped every few seconds.
+std::string render_metrics(
+    const submission_scheduler &scheduler,
+    const std::map<std::string, std::unique_ptr<task_config>> &tasks,
+    const remote_worker_pool *remote) {
+  std::string out;
+  // clang-format off
+  append_metric_header(out, "classroomperf_queue_depth", "Submissions waiting for a worker.", "gauge");
+  append_metric_sample(out, "classroomperf_queue_depth", "", scheduler.queue_depth());
+  append_metric_header(out, "classroomperf_jobs_in_flight", "Jobs currently running on a worker.", "gauge");
+  append_metric_sample(out, "classroomperf_jobs_in_flight", "", scheduler.jobs_in_flight());
+  append_metric_header(out, "classroomperf_remote_workers", "Registered remote workers (0 when submissions run locally).", "gauge");
+  append_metric_sample(out, "classroomperf_remote_workers", "", remote ? remote->size() : 0);
+
+  append_metric_header(out, "classroomperf_compile_seconds", "Duration of compile.sh.", "histogram");
+  metrics.compile_seconds.append(out, "classroomperf_compile_seconds", "");
+  append_metric_header(out, "classroomperf_benchmark_seconds", "Duration of the calibrated benchmark runs of a submission, retries included.", "histogram");
+  metrics.benchmark_seconds.append(out, "classroomperf_benchmark_seconds", "");
+  append_metric_header(out, "classroomperf_disassembly_seconds", "Duration of artifacts.sh (disassembly and highlighting) on first view.", "histogram");
+  metrics.artifact_seconds.append(out, "classroomperf_disassembly_seconds", "");
+
+  append_metric_header(out, "classroomperf_submissions_total", "Processed submissions by exit_code.", "counter");
+  for (int status : {0, 1, 2, 4, 5}) {
+    append_metric_sample(out, "classroomperf_submissions_total", "exit_code=\"" + std::to_string(status) + "\"", metrics.outcomes[status]);
+  }
+  append_metric_header(out, "classroomperf_submissions_rejected_total", "Submissions rejected before compiling (form, code rules or flags).", "counter");
+  append_metric_sample(out, "classroomperf_submissions_rejected_total", "", metrics.rejected);
+
+  append_metric_header(out, "classroomperf_leaderboard_entries", "Leaderboard size per task.", "gauge");
+  for (const auto &[name, task] : tasks) {
+    leaderboard_store::snapshot_ptr snapshot = task->leaderboard.snapshot();
+    append_metric_sample(out, "classroomperf_leaderboard_entries", "task=\"" + name + "\",view=\"all\"", snapshot->entries.size());
+    append_metric_sample(out, "classroomperf_leaderboard_entries", "task=\"" + name + "\",view=\"user_best\"", snapshot->user_best.size());
+  }
+
+  append_metric_header(out, "classroomperf_artifact_cache_requests_total", "Views that found the display artifacts in the record (hit) or had to generate them (miss).", "counter");
+  append_metric_sample(out, "classroomperf_artifact_cache_requests_total", "result=\"hit\"", metrics.artifact_hits);
+  append_metric_sample(out, "classroomperf_artifact_cache_requests_total", "result=\"miss\"", metrics.artifact_misses);
+  append_metric_header(out, "classroomperf_blob_writes_total", "Blob store writes that found identical content already stored (hit) or stored it (miss).", "counter");
+  append_metric_sample(out, "classroomperf_blob_writes_total", "result=\"hit\"", store.blob_hits);
+  append_metric_sample(out, "classroomperf_blob_writes_total", "result=\"miss\"", store.blob_misses);
+
+  append_metric_header(out, "classroomperf_http_request_seconds", "HTTP handler time per route, excluding the transfer of streamed responses.", "histogram");
+  for (const auto &[route, h] : metrics.http) {
+    size_t space = route.find(' ');
+    std::string labels = "method=\"" + route.substr(0, space) + "\",route=\"" + escape_label_value(route.substr(space + 1)) + "\"";
+    h->append(out, "classroomperf_http_request_seconds", labels);
+  }
+  // clang-format on
+  return out;
+}
+
+int main(int argc, char **argv) {
+  // clang-format off
+  cxxopts::Options options("ClassroomPerf", "Classroom performance competition");
+  options.add_options()
+    ("tasks", "Only host these tasks (default: every directory under tasks/).", cxxopts::value<std::vector<std::string>>())
+    ("host", "Bind address for the server.", cxxopts::value<std::string>()->default_value("0.0.0.0"))
+    ("port", "Bind port for the server.", cxxopts::value<int>()->default_value("5000"))
+    ("j,workers", "Submissions processed concurrently across all tasks (0: half the cores, or 16 with --worker-listen).", cxxopts::value<int>()->default_value("0"))
+    ("worker-listen", "Run submissions on remote workers connecting to this address (unix:<path> or <host>:<port>) instead of locally.", cxxopts::value<std::string>()->default_value(""))
+    ("worker-token", "Token workers must present to register (required with --worker-listen).", cxxopts::value<std::string>()->default_value(""))
+    ("compile-timeout", "Seconds a submission may take to compile (workers have their own limit).", cxxopts::value<double>()->default_value("60"))
+    ("benchmark-attempts", "Maximum benchmark runs when runs are noisy.", cxxopts::value<int>()->default_value("3"))
+    ("max-involuntary-switches", "Involuntary context switches above which a run is noisy.", cxxopts::value<long>()->default_value("10"))
+    ("max-system-time", "Fraction of CPU time in the kernel above which a run is noisy.", cxxopts::value<double>()->default_value("0.05"))
+    ("benchmark-core", "Pin benchmarks to this core and never run two at once (-1: no pinning).", cxxopts::value<int>()->default_value("-1"))
+    ("admin-token", "Token the /task/<name>/admin/ routes require as \"Authorization: Bearer <token>\" (empty: disabled).", cxxopts::value<std::string>()->default_value(""))
+    ("remeasure-interval", "Minutes between background re-measurements of the leaderboards (0: only on request).", cxxopts::value<int>()->default_value("0"))
+    ("remeasure-top", "Number of leaderboard entries to re-measure (0: all).", cxxopts::value<int>()->default_value("20"))
+    ("remeasure-rounds", "Interleaved rounds per re-measurement.", cxxopts::value<int>()->default_value("5"))
+    ("compare-rerun-interval", "Seconds a user has to wait between two paired re-runs on the comparison page.", cxxopts::value<int>()->default_value("60"))
+    ("max-calibration-drift", "Relative calibration change across a run above which it is rejected.", cxxopts::value<double>()->default_value("0.05"))
+    ("leaderboard-top", "Entries shown on the leaderboard page unless ?all=1 is given (0: all).", cxxopts::value<int>()->default_value("50"))
+    ("P,public", "Run the server publicly.")
+    ("R,regenerate-leaderboard", "Regenerate the leaderboard from the submission folder.")
+    ("h,help", "Print usage.")
+    ;
+  options.parse_positional({"tasks"});
+  // clang-format on
+
+  auto args = options.parse(argc, argv);
+  if (args.count("help")) {
+    std::cout << options.help() << std::endl;
+    std::exit(0);
+  }
+
+  bool public_mode = args["public"].count();
+  benchmark_settings.max_attempts = args["benchmark-attempts"].as<int>();
+  benchmark_settings.max_involuntary_switches =
+      args["max-involuntary-switches"].as<long>();
+  benchmark_settings.max_system_time_fraction =
+      args["max-system-time"].as<double>();
+  benchmark_settings.max_calibration_drift =
+      args["max-calibration-drift"].as<double>();
+  benchmark_settings.cpu = args["benchmark-core"].as<int>();
+  benchmark_settings.compile_timeout_seconds =
+      args["compile-timeout"].as<double>();
+  calibration_reference = load_calibration_reference(benchmark_settings.cpu);
+  std::string admin_token = args["admin-token"].as<std::string>();
+
+  std::vector<std::filesystem::path> task_folders;
+  if (args.count("tasks")) {
+    for (const std::string &name : args["tasks"].as<std::vector<std::string>>()) {
+      std::filesystem::path task_folder("tasks/");
+      task_folder /= name;
+      if (!std::filesystem::is_directory(task_folder)) {
+        std::printf("No task directory found: %s\n", task_folder.c_str());
+        return 1;
+      }
+      task_folders.push_back(task_folder);
+    }
+  } else {
+    for (auto it = std::filesystem::directory_iterator("tasks/");
+         it != std::filesystem::directory_iterator(); ++it) {
+      if (std::filesystem::is_directory(it->path())) {
+        task_folders.push_back(it->path());
+      }
+    }
+  }
+
+  std::srand(std::time(0));
+  submission_id_counter = 0;
+  bool regenerate = args.count("regenerate-leaderboard");
+
+  std::map<std::string, std::unique_ptr<task_config>> tasks;
+  for (const std::filesystem::path &folder : task_folders) {
+    std::unique_ptr<task_config> task = load_task(folder);
+    if (!task) {
+      std::printf("Skipping task %s.\n", folder.c_str());
+      continue;
+    }
+    task->leaderboard.publish(load_leaderboard(task->name, task->epoch, regenerate));
+    tasks[task->name] = std::move(task);
+  }
+  if (tasks.empty()) {
+    std::printf("No tasks to host.\n");
+    return 1;
+  }
+
+  std::unique_ptr<remote_worker_pool> remote;
+  std::string worker_address = args["worker-listen"].as<std::string>();
+  if (!worker_address.empty()) {
+    std::string worker_token = args["worker-token"].as<std::string>();
+    if (worker_token.empty()) {
+      std::printf("--worker-listen requires a --worker-token.\n");
+      return 1;
+    }
+    int fd = listen_socket(worker_address);
+    if (fd < 0) {
+      return 1;
+    }
+    remote = std::make_unique<remote_worker_pool>(fd, worker_token);
+    std::printf("Waiting for workers on %s.\n", worker_address.c_str());
+  }
+  remote_worker_pool *remote_workers = remote.get();
+
+  int num_workers = args["workers"].as<int>();
+  if (num_workers <= 0) {
+    // With remote workers, the scheduler threads only wait for results; the
+    // pool decides how many jobs actually run.
+    num_workers = remote ? 16
+                         : std::max(1u, std::thread::hardware_concurrency() / 2);
+  }
+  std::printf("Running submissions on %d workers.\n", num_workers);
+  submission_scheduler scheduler(num_workers);
+  artifact_generator artifacts;
+
+  int remeasure_top = args["remeasure-top"].as<int>();
+  size_t leaderboard_top = std::max(0, args["leaderboard-top"].as<int>());
+  remeasure_service remeasurer(scheduler, args["remeasure-rounds"].as<int>());
+  std::chrono::seconds compare_rerun_interval(
+      std::max(0, args["compare-rerun-interval"].as<int>()));
+  std::mutex compare_rerun_mutex;
+  std::map<std::string, std::chrono::steady_clock::time_point>
+      last_compare_rerun;
+  if (args["remeasure-interval"].as<int>() > 0) {
+    std::vector<task_config *> all_tasks;
+    for (auto &[name, task] : tasks) {
+      all_tasks.push_back(task.get());
+    }
+    remeasurer.schedule_periodic(
+        all_tasks, remeasure_top,
+        std::chrono::minutes(args["remeasure-interval"].as<int>()));
+  }
+
+  auto find_task = [&](const httplib::Request &req,
+                       httplib::Response &res) -> task_config * {
+    auto it = tasks.find(req.matches[1].str());
+    if (it == tasks.end()) {
+      res.set_content("Task not found.", "text/plain");
+      res.status = 404;
+      return nullptr;
+    }
+    return it->second.get();
+  };
 
   httplib::Server svr;
-  svr.set_mount_point("/", "./runtime/static/");
-  svr.Get("/(leaderboard)?", [&](const httplib::Request &req,
-                                 httplib::Response &res) {
+  // Routes are registered through these, so every handler is timed.
+  auto get = [&](const std::string &pattern, httplib::Server::Handler handler) {
+    svr.Get(pattern, metrics.timed("GET", pattern, std::move(handler)));
+  };
+  auto post = [&](const std::string &pattern, httplib::Server::Handler handler) {
+    svr.Post(pattern, metrics.timed("POST", pattern, std::move(handler)));
+  };
+  get("/", [&](const httplib::Request &, httplib::Response &res) {
+    res.set_content(render_task_index(tasks), "text/html");
+    res.status = 200;
+  });
+  get("/metrics", [&](const httplib::Request &, httplib::Response &res) {
+    res.set_content(render_metrics(scheduler, tasks, remote_workers),
+                    "text/plain; version=0.0.4");
+  });
+
+  get("/task/([\\w-]+)", [&](const httplib::Request &req,
+                             httplib::Response &res) {
+    res.set_redirect("/task/" + req.matches[1].str() + "/");
+  });
+  get("/task/([\\w-]+)/(leaderboard)?", [&](const httplib::Request &req,
+                                            httplib::Response &res) {
+    task_config *task = find_task(req, res);
+    if (!task) {
+      return;
+    }
     // std::string user_id = anonimify(req.remote_addr, task);
     std::string user_id = find_user_id_in_request(req);
     if (user_id == "") {
-      res.set_header("Set-Cookie", "userId=" + generate_user_id());
+      res.set_header("Set-Cookie", "userId=" + generate_user_id() + "; Path=/");
     }
-    res.set_content(render_leaderboard(task, leaderboard, user_id, public_mode),
+    leaderboard_store::snapshot_ptr entries = task->leaderboard.snapshot();
+    leaderboard_store::snapshot_ptr remeasured = task->remeasured.snapshot();
+    std::string remeasured_html = render_remeasured(
+        task->name, remeasured->entries, task->remeasured_at,
+        entries->entries, user_id, public_mode);
+    size_t top = req.get_param_value("all") == "1" ? 0 : leaderboard_top;
+    res.set_content(render_leaderboard(task->name, entries->entries, top,
+                                       user_id, public_mode, remeasured_html),
                     "text/html");
     res.status = 200;
   });
-  svr.Post("/submit", [&](const httplib::Request &req, httplib::Response &res) {
+
+  // JSON leaderboard: ?mode=all|user_best&top=K&limit=N&cursor=<next_cursor>
+  get("/task/([\\w-]+)/api/leaderboard", [&](const httplib::Request &req,
+                                             httplib::Response &res) {
+    task_config *task = find_task(req, res);
+    if (!task) {
+      return;
+    }
+    std::string user_id = find_user_id_in_request(req);
+    size_t top = std::max(0, std::atoi(req.get_param_value("top").c_str()));
+    size_t limit = 50;
+    if (req.has_param("limit")) {
+      limit = std::clamp(std::atoi(req.get_param_value("limit").c_str()), 1,
+                         500);
+    }
+    leaderboard_store::snapshot_ptr snapshot = task->leaderboard.snapshot();
+    nlohmann::json page;
+    if (!leaderboard_page_json(task->name, *snapshot,
+                               req.get_param_value("mode"), top, limit,
+                               req.get_param_value("cursor"), user_id, page)) {
+      res.set_content("Invalid mode or cursor.", "text/plain");
+      res.status = 400;
+      return;
+    }
+    res.set_content(page.dump(), "application/json");
+    res.status = 200;
+  });
+  get("/task/([\\w-]+)/make_submission.html", [&](const httplib::Request &req,
+                                                  httplib::Response &res) {
+    task_config *task = find_task(req, res);
+    if (!task) {
+      return;
+    }
+    std::string html = read_file("runtime/templates/make_submission.html");
+    html = replace_all(html, "${TASK}", task->name);
+    html = replace_all(html, "${SIGNATURE}", task->signature);
+    res.set_content(html, "text/html");
+  });
+  post("/task/([\\w-]+)/submit", [&](const httplib::Request &req,
+                                     httplib::Response &res) {
+    task_config *task = find_task(req, res);
+    if (!task) {
+      return;
+    }
     std::string user_id = find_user_id_in_request(req);
     if (req.has_param("code") && req.has_param("flags") &&
         req.has_param("author") && user_id != "") {
@@ -590,13 +2218,15 @@ int main(int argc, char **argv) {
             author == "HybridTeam" || author == "Teacher")) {
         res.set_content("Invalid form submission.", "text/plain");
         res.status = 404;
+        metrics.rejected++;
         return;
       }
 
-      bool valid_code = validate_code_input(code);
+      bool valid_code = validate_code_input(code, task->bad_code_regex);
       if (!valid_code) {
         res.set_content("Code does not comply with the rules!", "text/plain");
         res.status = 404;
+        metrics.rejected++;
         return;
       }
 
@@ -604,23 +2234,40 @@ int main(int argc, char **argv) {
       if (!valid_flags) {
         res.set_content("Disallowed compiler flags.", "text/plain");
         res.status = 404;
+        metrics.rejected++;
         return;
       }
 
       std::string submission_id = generate_submission_id();
-
-      int exit_code = run_validated_submission(
-          task, user_id, submission_id, code, flags, symbol, author, req.remote_addr);
+      std::string ip = req.remote_addr;
+
+      std::future<int> job = scheduler.enqueue(task->name, [=]() {
+        return run_validated_submission(task->name, user_id, submission_id,
+                                        code, flags, task->symbol, author, ip,
+                                        task->compile_flags,
+                                        task->mode == "scaling", task->dataset,
+                                        task->epoch, remote_workers);
+      });
+      int exit_code = job.get();
+      if (exit_code == submission_not_stored) {
+        res.set_content(
+            "The submission could not be stored, please try again.",
+            "text/plain");
+        res.status = 500;
+        return;
+      }
 
       if (exit_code == 0) {
-        submission_result result = load_submission_result(task, submission_id);
+        submission_result result =
+            load_submission_result(task->name, submission_id);
 
         leaderboard_entry e = make_leaderboard_entry(result);
 
         // save the entry
 #if STORE_LEADERBOARD
-        std::filesystem::path lbep =
-            leaderboard_dir / (e.submission_id + ".json");
+        std::filesystem::path lbep = "leaderboard";
+        lbep /= task->name;
+        lbep /= e.submission_id + ".json";
         nlohmann::json js = e;
         std::ofstream lbef(lbep.string());
         lbef << js.dump(2);
@@ -628,8 +2275,7 @@ int main(int argc, char **argv) {
 #endif
 
         // add entry to leaderboard
-        leaderboard.push_back(std::move(e));
-        sort_leaderboard(leaderboard);
+        task->leaderboard.insert(std::move(e));
       }
 
       res.set_redirect("view_submission?id=" + submission_id);
@@ -637,17 +2283,19 @@ int main(int argc, char **argv) {
     } else {
       res.set_content("Invalid form submission.", "text/plain");
       res.status = 404;
+      metrics.rejected++;
     }
   });
-  svr.Get("/view_submission", [&](const httplib::Request &req,
-                                  httplib::Response &res) {
+  get("/task/([\\w-]+)/view_submission", [&](const httplib::Request &req,
+                                             httplib::Response &res) {
+    task_config *task = find_task(req, res);
+    if (!task) {
+      return;
+    }
     std::string user_id = find_user_id_in_request(req);
     std::string submission_id = req.get_param_value("id");
-    auto it = std::find_if(leaderboard.begin(), leaderboard.end(),
-                           [&submission_id](const auto &e) {
-                             return e.submission_id == submission_id;
-                           });
-    submission_result result = load_submission_result(task, submission_id);
+    submission_result result =
+        load_submission_result(task->name, submission_id, true);
     if (!result.found) {
       res.set_content("Submission not found.", "text/plain");
       res.status = 404;
@@ -662,8 +2310,150 @@ int main(int argc, char **argv) {
       }
     }
 
-    std::string html = render_submission_result(result);
-    res.set_content(html, "text/html");
+    if (artifacts.generate_if_missing(task->name, submission_id,
+                                      task->symbol)) {
+      result = load_submission_result(task->name, submission_id, true);
+    }
+
+    auto stream = std::make_shared<response_stream>(
+        stream_submission_result(result));
+    res.set_content_provider(
+        stream->size(), "text/html",
+        [stream](size_t offset, size_t length, httplib::DataSink &sink) {
+          return stream->write(offset, std::min<size_t>(length, 1 << 16),
+                               sink.write);
+        });
+  });
+
+  get("/task/([\\w-]+)/compare", [&](const httplib::Request &req,
+                                     httplib::Response &res) {
+    task_config *task = find_task(req, res);
+    if (!task) {
+      return;
+    }
+    std::string user_id = find_user_id_in_request(req);
+    submission_result a =
+        load_submission_result(task->name, req.get_param_value("a"));
+    submission_result b =
+        load_submission_result(task->name, req.get_param_value("b"));
+    if (!a.found || !b.found) {
+      res.set_content("Submission not found.", "text/plain");
+      res.status = 404;
+      return;
+    }
+    if (!public_mode && (a.user_id != user_id || b.user_id != user_id)) {
+      res.set_content("Not your submission.", "text/plain");
+      res.status = 403;
+      return;
+    }
+    // The disassembly diff needs the artifacts of both.
+    if (artifacts.generate_if_missing(task->name, a.submission_id,
+                                      task->symbol)) {
+      a = load_submission_result(task->name, a.submission_id);
+    }
+    if (artifacts.generate_if_missing(task->name, b.submission_id,
+                                      task->symbol)) {
+      b = load_submission_result(task->name, b.submission_id);
+    }
+
+    std::vector<double> samples_a = parse_timing_samples(a.benchmark_output);
+    std::vector<double> samples_b = parse_timing_samples(b.benchmark_output);
+    comparison_samples source = comparison_samples::original;
+    remeasure_service::comparison rerun;
+    if (remeasurer.find_comparison(task, a.submission_id, b.submission_id,
+                                   rerun)) {
+      if (!rerun.done) {
+        source = comparison_samples::rerun_queued;
+      } else if (!rerun.ok) {
+        source = comparison_samples::rerun_failed;
+      } else {
+        source = comparison_samples::rerun;
+        samples_a = rerun.samples_a;
+        samples_b = rerun.samples_b;
+      }
+    }
+    // In private mode, the owner of both; see the check above.
+    bool can_rerun = !user_id.empty() && a.status == 0 && b.status == 0 &&
+                     (a.user_id == user_id || b.user_id == user_id);
+    res.set_content(
+        render_comparison(a, b, samples_a, samples_b, source, can_rerun),
+        "text/html");
+  });
+  // Queues a paired re-run on the background re-measurement queue, which only
+  // runs while no submission is waiting. Only the owner of one of the two
+  // submissions may request it, once per --compare-rerun-interval.
+  post("/task/([\\w-]+)/compare_rerun", [&](const httplib::Request &req,
+                                           httplib::Response &res) {
+    task_config *task = find_task(req, res);
+    if (!task) {
+      return;
+    }
+    std::string user_id = find_user_id_in_request(req);
+    std::string id_a = req.get_param_value("a");
+    std::string id_b = req.get_param_value("b");
+    submission_result a = load_submission_result(task->name, id_a);
+    submission_result b = load_submission_result(task->name, id_b);
+    if (!a.found || !b.found || a.status != 0 || b.status != 0) {
+      res.set_content("Submission not found.", "text/plain");
+      res.status = 404;
+      return;
+    }
+    bool owns_a = !user_id.empty() && a.user_id == user_id;
+    bool owns_b = !user_id.empty() && b.user_id == user_id;
+    if (public_mode ? !(owns_a || owns_b) : !(owns_a && owns_b)) {
+      res.set_content("Not your submission.", "text/plain");
+      res.status = 403;
+      return;
+    }
+    std::string page = "compare?a=" + a.submission_id + "&b=" + b.submission_id;
+    std::lock_guard<std::mutex> lock(compare_rerun_mutex);
+    auto now = std::chrono::steady_clock::now();
+    auto last = last_compare_rerun.find(user_id);
+    if (last != last_compare_rerun.end() &&
+        now - last->second < compare_rerun_interval) {
+      res.set_content("Too many re-runs, try again later.", "text/plain");
+      res.status = 429;
+      return;
+    }
+    // Only a re-run that was actually queued counts against the limit.
+    switch (remeasurer.enqueue_comparison(task, a.submission_id,
+                                          b.submission_id)) {
+      case remeasure_service::enqueue_result::queued:
+        last_compare_rerun[user_id] = now;
+        res.set_redirect(page);
+        break;
+      case remeasure_service::enqueue_result::pending:
+        res.set_content("A re-run of these submissions is already queued; "
+                        "its results will appear on the comparison page.",
+                        "text/plain");
+        break;
+      case remeasure_service::enqueue_result::full:
+        res.set_content("Too many re-runs are queued, try again later.",
+                        "text/plain");
+        res.status = 503;
+        break;
+    }
+  });
+  post("/task/([\\w-]+)/admin/remeasure", [&](const httplib::Request &req,
+                                             httplib::Response &res) {
+    task_config *task = find_task(req, res);
+    if (!task) {
+      return;
+    }
+    // From a header, so it stays out of access logs and browser history:
+    //   curl -X POST -H "Authorization: Bearer <token>" .../admin/remeasure
+    if (admin_token.empty() ||
+        req.get_header_value("Authorization") != "Bearer " + admin_token) {
+      res.set_content("Not allowed.", "text/plain");
+      res.status = 403;
+      return;
+    }
+    int top = remeasure_top;
+    if (req.has_param("top")) {
+      top = std::atoi(req.get_param_value("top").c_str());
+    }
+    remeasurer.enqueue(task, top);
+    res.set_content("Re-measurement queued.", "text/plain");
   });
 
   std::string host = args["host"].as<std::string>();
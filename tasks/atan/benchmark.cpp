@@ -10,6 +10,7 @@
 
 #include "submitted_code.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <random>
 #include <limits>
@@ -34,6 +35,36 @@ static void correctness_test(float *values, int num_inputs, float max_error) {
   }
 }
 
+// Random strides between checked blocks of timed calls.
+struct verification_sampler {
+  explicit verification_sampler(int mean_stride)
+      : state(uint64_t(std::random_device()()) << 32 ^ __rdtsc()),
+        max_stride(2 * mean_stride) {
+    state |= 1;
+  }
+
+  // Distance to the next check, uniform in [1, 2 * mean_stride].
+  int next() {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return 1 + int(state % max_stride);
+  }
+
+  uint64_t state;
+  int max_stride;
+};
+
+static void verification_failed(float x, float actual, float expected,
+                                float max_error) {
+  std::cerr << "Incorrect atan implementation during the benchmark, run invalidated." << std::endl;
+  std::cerr << std::setprecision(20);
+  std::cerr << "student_atan(" << x << ") = " << actual << std::endl;
+  std::cerr << "std::atan(" << x << ") = " << expected << std::endl;
+  std::cerr << "Allowed error: " << max_error << std::endl;
+  std::exit(1);
+}
+
 int main(int argc, char **argv) {
   using namespace std::chrono;
 
@@ -51,6 +82,13 @@ int main(int argc, char **argv) {
   constexpr float max_error = MAX_ERROR;
   correctness_test(values, num_inputs, max_error);
 
+  float reference[num_inputs];
+  for (int i = 0; i < num_inputs; ++i) {
+    reference[i] = std::atan(values[i]);
+  }
+  // Strides in blocks of 8 calls: on average one checked block per ~4000 calls.
+  verification_sampler sampler(512);
+
   float r = 0.0f;
 
   // Benchmark
@@ -62,15 +100,55 @@ int main(int argc, char **argv) {
     high_resolution_clock::time_point start = high_resolution_clock::now();
     int64_t start_cycle = __rdtsc();
 #if 1
-    for (int i = 0; i < test_count; i += 8) {
-      r += student_atan(values[(i + 0) % num_inputs]);
-      r += student_atan(values[(i + 1) % num_inputs]);
-      r += student_atan(values[(i + 2) % num_inputs]);
-      r += student_atan(values[(i + 3) % num_inputs]);
-      r += student_atan(values[(i + 4) % num_inputs]);
-      r += student_atan(values[(i + 5) % num_inputs]);
-      r += student_atan(values[(i + 6) % num_inputs]);
-      r += student_atan(values[(i + 7) % num_inputs]);
+    // Segments of unchecked blocks of 8 calls, each preceded by one block
+    // whose results are verified. The unchecked loop is the plain benchmark.
+    constexpr int num_blocks = test_count / 8;
+    for (int block = 0; block < num_blocks;) {
+      int i = block * 8;
+      float y[8];
+      y[0] = student_atan(values[(i + 0) % num_inputs]);
+      y[1] = student_atan(values[(i + 1) % num_inputs]);
+      y[2] = student_atan(values[(i + 2) % num_inputs]);
+      y[3] = student_atan(values[(i + 3) % num_inputs]);
+      y[4] = student_atan(values[(i + 4) % num_inputs]);
+      y[5] = student_atan(values[(i + 5) % num_inputs]);
+      y[6] = student_atan(values[(i + 6) % num_inputs]);
+      y[7] = student_atan(values[(i + 7) % num_inputs]);
+      r += y[0];
+      r += y[1];
+      r += y[2];
+      r += y[3];
+      r += y[4];
+      r += y[5];
+      r += y[6];
+      r += y[7];
+      // Branch-free comparison, so the block vectorizes like the others.
+      int failures = 0;
+      for (int k = 0; k < 8; ++k) {
+        failures += !(std::abs(y[k] - reference[(i + k) % num_inputs]) <= max_error);
+      }
+      if (failures != 0) {
+        for (int k = 0; k < 8; ++k) {
+          int j = (i + k) % num_inputs;
+          if (!(std::abs(y[k] - reference[j]) <= max_error)) {
+            verification_failed(values[j], y[k], reference[j], max_error);
+          }
+        }
+      }
+      ++block;
+
+      int segment_end = std::min(num_blocks, block + sampler.next());
+      for (; block < segment_end; ++block) {
+        int i = block * 8;
+        r += student_atan(values[(i + 0) % num_inputs]);
+        r += student_atan(values[(i + 1) % num_inputs]);
+        r += student_atan(values[(i + 2) % num_inputs]);
+        r += student_atan(values[(i + 3) % num_inputs]);
+        r += student_atan(values[(i + 4) % num_inputs]);
+        r += student_atan(values[(i + 5) % num_inputs]);
+        r += student_atan(values[(i + 6) % num_inputs]);
+        r += student_atan(values[(i + 7) % num_inputs]);
+      }
     }
 #else
     for (int i = 0; i < test_count; ++i) {
@@ -0,0 +1,275 @@
+// clang-format off
+#include <immintrin.h>
+#if _WIN32
+#include <intrin.h>
+#else
+# include <x86intrin.h>
+#endif
+
+#include <cmath>
+#include <cstddef>
+
+#define MAX_ERROR 1e-6f
+
+#include "submitted_code.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <limits>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+// clang-format on
+
+// The harness owns the threads: it splits the input into one contiguous slice
+// per worker and calls student_atan_array() on each slice, for every thread
+// count from 1 up to the number of cores the benchmark may use. Workers are
+// pinned and persistent, so only the kernel itself is timed. Idle workers and
+// the waiting main thread sleep on futexes rather than spinning, so they take
+// no time slices or power budget from the threads running the kernel.
+
+static void correctness_test(const float *in, const float *out, size_t n,
+                             float max_error) {
+  for (size_t i = 0; i < n; ++i) {
+    float actual = out[i];
+    float expected = std::atan(in[i]);
+    if (!(std::abs(actual - expected) <= max_error)) {
+      std::cerr << "Incorrect atan implementation." << std::endl;
+      std::cerr << std::setprecision(20);
+      std::cerr << "out[" << i << "] = " << actual << std::endl;
+      std::cerr << "std::atan(" << in[i] << ") = " << expected << std::endl;
+      std::cerr << "Error: " << (actual - expected) << std::endl;
+      std::cerr << "Allowed error: " << max_error << std::endl;
+      std::exit(1);
+    }
+  }
+}
+
+// Random strides between the outputs checked after each timed run.
+struct verification_sampler {
+  explicit verification_sampler(int mean_stride)
+      : state(uint64_t(std::random_device()()) << 32 ^ __rdtsc()),
+        max_stride(2 * mean_stride) {
+    state |= 1;
+  }
+
+  // Distance to the next check, uniform in [1, 2 * mean_stride].
+  int next() {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return 1 + int(state % max_stride);
+  }
+
+  uint64_t state;
+  int max_stride;
+};
+
+static void verification_failed(size_t i, float x, float actual,
+                                float expected, float max_error) {
+  std::cerr << "Incorrect atan implementation during the benchmark, run invalidated." << std::endl;
+  std::cerr << std::setprecision(20);
+  std::cerr << "out[" << i << "] = " << actual << std::endl;
+  std::cerr << "std::atan(" << x << ") = " << expected << std::endl;
+  std::cerr << "Allowed error: " << max_error << std::endl;
+  std::exit(1);
+}
+
+static void futex_wait(std::atomic<uint32_t> &word, uint32_t expected) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT_PRIVATE,
+          expected, nullptr, nullptr, 0);
+}
+
+static void futex_wake_all(std::atomic<uint32_t> &word) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE_PRIVATE,
+          INT32_MAX, nullptr, nullptr, 0);
+}
+
+struct worker_pool {
+  static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t),
+                "futex word must be a plain 32-bit integer");
+
+  worker_pool(const std::vector<int> &cpus, const float *in, float *out)
+      : in(in), out(out) {
+    for (size_t w = 0; w < cpus.size(); ++w) {
+      threads.emplace_back([this, w]() { loop(w); });
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpus[w], &set);
+      pthread_setaffinity_np(threads.back().native_handle(), sizeof(set), &set);
+    }
+  }
+
+  ~worker_pool() {
+    stop = true;
+    generation.fetch_add(1, std::memory_order_release);
+    futex_wake_all(generation);
+    for (std::thread &t : threads) {
+      t.join();
+    }
+  }
+
+  // Runs the kernel over [0, n) split across the first num_threads workers
+  // and blocks until all of them are done.
+  void run(int num_threads, size_t n) {
+    active = num_threads;
+    size = n;
+    remaining.store(num_threads, std::memory_order_relaxed);
+    generation.fetch_add(1, std::memory_order_release);
+    futex_wake_all(generation);
+    uint32_t left;
+    while ((left = remaining.load(std::memory_order_acquire)) != 0) {
+      futex_wait(remaining, left);
+    }
+  }
+
+  void loop(size_t w) {
+    uint32_t seen = 0;
+    while (true) {
+      uint32_t current;
+      while ((current = generation.load(std::memory_order_acquire)) == seen) {
+        futex_wait(generation, seen);
+      }
+      seen = current;
+      if (stop) {
+        return;
+      }
+      if (int(w) < active) {
+        size_t begin = size * w / active;
+        size_t end = size * (w + 1) / active;
+        student_atan_array(in + begin, out + begin, end - begin);
+        if (remaining.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          futex_wake_all(remaining);
+        }
+      }
+    }
+  }
+
+  const float *in;
+  float *out;
+  std::vector<std::thread> threads;
+  std::atomic<uint32_t> generation{0};
+  std::atomic<uint32_t> remaining{0};
+  std::atomic<bool> stop{false};
+  int active{0};
+  size_t size{0};
+};
+
+int main(int argc, char **argv) {
+  using namespace std::chrono;
+
+  std::vector<int> cpus;
+  cpu_set_t allowed;
+  sched_getaffinity(0, sizeof(allowed), &allowed);
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &allowed)) {
+      cpus.push_back(cpu);
+    }
+  }
+
+  std::uniform_real_distribution<float> udist(-0.5f, 0.5f);
+  std::mt19937 mt;
+  mt.seed(42);
+
+  constexpr size_t num_inputs = 1 << 22;
+  std::vector<float> in(num_inputs);
+  std::vector<float> out(num_inputs);
+  for (size_t i = 0; i < num_inputs; ++i) {
+    in[i] = udist(mt);
+  }
+
+  std::vector<int> thread_counts;
+  for (int t = 1; t < int(cpus.size()); t *= 2) {
+    thread_counts.push_back(t);
+  }
+  thread_counts.push_back(cpus.size());
+
+  worker_pool pool(cpus, in.data(), out.data());
+  constexpr float max_error = MAX_ERROR;
+  constexpr int repetitions = 20;
+
+  std::vector<float> reference(num_inputs);
+  for (size_t i = 0; i < num_inputs; ++i) {
+    reference[i] = std::atan(in[i]);
+  }
+  // On average one checked output per 4096.
+  verification_sampler sampler(4096);
+  std::vector<size_t> sample;
+
+  double single_thread_throughput = 0;
+  double best_time = 0;
+  double best_cycles_per_call = 0;
+  std::vector<std::string> scaling_lines;
+  std::cerr << std::setprecision(9);
+  for (int threads : thread_counts) {
+    std::fill(out.begin(), out.end(), std::numeric_limits<float>::quiet_NaN());
+    double best = std::numeric_limits<double>::max();
+    int64_t best_cycle_count = std::numeric_limits<int64_t>::max();
+    for (int rep = 0; rep < repetitions; ++rep) {
+      sample.clear();
+      for (size_t i = sampler.next(); i < num_inputs; i += sampler.next()) {
+        sample.push_back(i);
+        out[i] = reference[i] + 1.0f;
+      }
+      high_resolution_clock::time_point start = high_resolution_clock::now();
+      int64_t start_cycle = __rdtsc();
+      pool.run(threads, num_inputs);
+      int64_t stop_cycle = __rdtsc();
+      high_resolution_clock::time_point stop = high_resolution_clock::now();
+      double elapsed_seconds =
+          std::chrono::duration_cast<std::chrono::duration<double> >(stop - start)
+              .count();
+      for (size_t i : sample) {
+        if (!(std::abs(out[i] - reference[i]) <= max_error)) {
+          verification_failed(i, in[i], out[i], reference[i], max_error);
+        }
+      }
+      // Repetitions at the ranked thread count are the timing samples of the
+      // comparison page.
+      if (threads == thread_counts.back()) {
+        std::cerr << "Time: " << elapsed_seconds << "  (threads: " << threads << ")" << std::endl;
+      } else {
+        std::cerr << "Threads: " << threads << "  Time: " << elapsed_seconds << std::endl;
+      }
+      if (elapsed_seconds < best) {
+        best = elapsed_seconds;
+        best_cycle_count = stop_cycle - start_cycle;
+      }
+    }
+    // Every slice must have been written correctly.
+    correctness_test(in.data(), out.data(), num_inputs, max_error);
+
+    double throughput = num_inputs / best;
+    if (threads == 1) {
+      single_thread_throughput = throughput;
+    }
+    double efficiency = throughput / (single_thread_throughput * threads);
+    std::cerr << "Threads: " << threads << "  Best time: " << best
+              << "  Elements/s: " << throughput
+              << "  Parallel efficiency: " << efficiency << std::endl;
+    // Ranked by the time at the highest thread count.
+    best_time = best;
+    best_cycles_per_call = best_cycle_count / double(num_inputs);
+    char buf[200];
+    std::snprintf(buf, sizeof(buf), "scaling %d %.9f %.6e %.6f", threads, best,
+                  throughput, efficiency);
+    scaling_lines.push_back(buf);
+  }
+
+  std::printf("%.9f\n", best_time);
+  std::printf("%.9f\n", best_cycles_per_call);
+  for (const std::string &line : scaling_lines) {
+    std::printf("%s\n", line.c_str());
+  }
+
+  return 0;
+}
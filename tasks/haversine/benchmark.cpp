@@ -7,16 +7,23 @@
 #endif
 
 #include <cmath>
+#include <cstring>
 
 #define MAX_ERROR 1e-6f
 
 #include "submitted_code.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <random>
 #include <limits>
 #include <iostream>
 #include <iomanip>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 // clang-format on
 
 static float correct_haversine(float radius, float lat1, float lon1, float lat2, float lon2) {
@@ -25,18 +32,81 @@ static float correct_haversine(float radius, float lat1, float lon1, float lat2,
   return 2.0f * radius * std::asin(std::sqrt(s1 * s1 + std::cos(lat1) * std::cos(lat2) * s2 * s2));
 }
 
-static void correctness_test(float *values, int num_inputs, float max_error) {
-  for (int i = 0; i < num_inputs; ++i) {
-    float rad = values[(i + 1) % num_inputs];
-    float lat1 = values[(i + 2) % num_inputs];
-    float lon1 = values[(i + 0) % num_inputs];
-    float lat2 = values[(i + 4) % num_inputs];
-    float lon2 = values[(i + 5) % num_inputs];
-    float actual = student_haversine(rad, lat1, lon1, lat2, lon2);
-    float expected = correct_haversine(rad, lat1, lon1, lat2, lon2);
-    if (std::abs(actual - expected) > max_error) {
+// Task inputs, one column per argument, mapped read-only from the dataset the
+// server generates (dataset.hpp): "CPDSET01", u32 column count, u32 zero,
+// u64 row count, then per column char name[16], u32 type (1 = float), u32 zero
+// and u64 offset of the column data.
+struct input_dataset {
+  explicit input_dataset(const char *path) {
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+      fail(path, "cannot open");
+    }
+    size = st.st_size;
+    // Populated up front, so no run pays for page faults.
+    void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+      fail(path, "cannot map");
+    }
+    data = static_cast<const char *>(p);
+    if (size < 24 || std::memcmp(data, "CPDSET01", 8) != 0) {
+      fail(path, "not a dataset");
+    }
+    std::memcpy(&column_count, data + 8, sizeof(column_count));
+    std::memcpy(&rows, data + 16, sizeof(rows));
+    if (24 + uint64_t(column_count) * 32 > size) {
+      fail(path, "truncated header");
+    }
+  }
+
+  const float *column(const char *name) const {
+    for (uint32_t c = 0; c < column_count; ++c) {
+      const char *entry = data + 24 + c * 32;
+      uint32_t type;
+      uint64_t offset;
+      std::memcpy(&type, entry + 16, sizeof(type));
+      std::memcpy(&offset, entry + 24, sizeof(offset));
+      if (std::strncmp(entry, name, 16) == 0 && type == 1 &&
+          offset % alignof(float) == 0 && offset <= size &&
+          rows <= (size - offset) / sizeof(float)) {
+        return reinterpret_cast<const float *>(data + offset);
+      }
+    }
+    fail(name, "missing column");
+    return nullptr;
+  }
+
+  [[noreturn]] static void fail(const char *what, const char *why) {
+    std::cerr << "Dataset error: " << what << ": " << why << std::endl;
+    std::exit(1);
+  }
+
+  const char *data{nullptr};
+  size_t size{0};
+  uint32_t column_count{0};
+  uint64_t rows{0};
+};
+
+struct haversine_inputs {
+  const float *radius;
+  const float *lat1;
+  const float *lon1;
+  const float *lat2;
+  const float *lon2;
+  size_t count;
+};
+
+static void correctness_test(const haversine_inputs &in, float max_error) {
+  for (size_t i = 0; i < in.count; ++i) {
+    float actual = student_haversine(in.radius[i], in.lat1[i], in.lon1[i], in.lat2[i], in.lon2[i]);
+    float expected = correct_haversine(in.radius[i], in.lat1[i], in.lon1[i], in.lat2[i], in.lon2[i]);
+    if (!(std::abs(actual - expected) <= max_error)) {
       std::cerr << "Incorrect haversine implementation." << std::endl;
       std::cerr << std::setprecision(20);
+      std::cerr << "student_haversine(" << in.radius[i] << ", " << in.lat1[i] << ", " << in.lon1[i] << ", " << in.lat2[i] << ", " << in.lon2[i] << ") = " << actual << std::endl;
+      std::cerr << "Expected: " << expected << std::endl;
       std::cerr << "Error: " << (actual - expected) << std::endl;
       std::cerr << "Allowed error: " << max_error << std::endl;
       std::exit(1);
@@ -44,22 +114,53 @@ static void correctness_test(float *values, int num_inputs, float max_error) {
   }
 }
 
+// Random strides between the checked calls of the timed loop.
+struct verification_sampler {
+  explicit verification_sampler(int mean_stride)
+      : state(uint64_t(std::random_device()()) << 32 ^ __rdtsc()),
+        max_stride(2 * mean_stride) {
+    state |= 1;
+  }
+
+  // Distance to the next check, uniform in [1, 2 * mean_stride].
+  int next() {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return 1 + int(state % max_stride);
+  }
+
+  uint64_t state;
+  int max_stride;
+};
+
+static void verification_failed(float actual, float expected, float max_error) {
+  std::cerr << "Incorrect haversine implementation during the benchmark, run invalidated." << std::endl;
+  std::cerr << std::setprecision(20);
+  std::cerr << "Error: " << (actual - expected) << std::endl;
+  std::cerr << "Allowed error: " << max_error << std::endl;
+  std::exit(1);
+}
+
 int main(int argc, char **argv) {
   using namespace std::chrono;
 
-  std::uniform_real_distribution<float> udist(-M_PI*0.5f, M_PI*0.5f);
-  std::mt19937 mt;
-  mt.seed(42);
-
-  constexpr size_t num_inputs = 2048;
-  float values[num_inputs];
-  for (int i = 0; i < num_inputs; ++i) {
-    values[i] = udist(mt);
-  }
+  // The server links the dataset into the working directory.
+  input_dataset dataset(argc > 1 ? argv[1] : "dataset.bin");
+  haversine_inputs in;
+  in.radius = dataset.column("radius");
+  in.lat1 = dataset.column("lat1");
+  in.lon1 = dataset.column("lon1");
+  in.lat2 = dataset.column("lat2");
+  in.lon2 = dataset.column("lon2");
+  in.count = dataset.rows;
 
   // Correctness
   constexpr float max_error = MAX_ERROR;
-  correctness_test(values, num_inputs, max_error);
+  correctness_test(in, max_error);
+
+  // Strides in steps of 16 calls: on average one checked call per ~16000 calls.
+  verification_sampler sampler(1024);
 
   float r = 0.0f;
 
@@ -67,18 +168,30 @@ int main(int argc, char **argv) {
   double best_time = std::numeric_limits<double>::max();
   int64_t best_cycle_count = std::numeric_limits<int64_t>::max();
   int best_run = -1;
-  constexpr int test_count = 1024 * 1024;
+  const size_t test_count = in.count;
   for (int run = 0; run < 40 || best_run > run - 10; ++run) {
     high_resolution_clock::time_point start = high_resolution_clock::now();
     int64_t start_cycle = __rdtsc();
 
-    for (int i = 0; i < test_count; ++i) {
-      float rad = values[(i + 0) % num_inputs];
-      float lat1 = values[(i + 4) % num_inputs];
-      float lon1 = values[(i + 3) % num_inputs];
-      float lat2 = values[(i + 2) % num_inputs];
-      float lon2 = values[(i + 1) % num_inputs];
-      r += student_haversine(rad, lat1, lon1, lat2, lon2);
+    // Segments of unchecked calls, each preceded by one call whose result is
+    // verified against the reference computed the same (scalar) way. The
+    // unchecked loop is the plain benchmark; its length is a multiple of 16,
+    // so a vectorized loop has no scalar remainder.
+    for (size_t i = 0; i < test_count;) {
+      {
+        float y = student_haversine(in.radius[i], in.lat1[i], in.lon1[i], in.lat2[i], in.lon2[i]);
+        float expected = correct_haversine(in.radius[i], in.lat1[i], in.lon1[i], in.lat2[i], in.lon2[i]);
+        if (!(std::abs(y - expected) <= max_error)) {
+          verification_failed(y, expected, max_error);
+        }
+        r += y;
+        ++i;
+      }
+
+      size_t segment_end = std::min(test_count, i + 16 * size_t(sampler.next()));
+      for (; i < segment_end; ++i) {
+        r += student_haversine(in.radius[i], in.lat1[i], in.lon1[i], in.lat2[i], in.lon2[i]);
+      }
     }
 
     int64_t stop_cycle = __rdtsc();
@@ -103,7 +216,7 @@ int main(int argc, char **argv) {
   std::cerr << "cycles / student_atan: " << (best_cycle_count / double(test_count)) << std::endl;
 
   // Correctness (no cheaters!)
-  correctness_test(values, num_inputs, max_error);
+  correctness_test(in, max_error);
 
   std::printf("%.9f\n", best_time);
   std::printf("%.9f\n", (best_cycle_count / double(test_count)));
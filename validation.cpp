@@ -0,0 +1,72 @@
+#include "validation.hpp"
+
+#include <regex>
+
+namespace {
+
+bool contains(const std::string &code, std::string substr) {
+  return code.find(substr) != std::string::npos;
+}
+bool contains_regex(const std::string &code, std::string regex) {
+  std::regex r(regex);
+  return std::regex_search(code, r);
+}
+
+}  // namespace
+
+bool validate_code_input(const std::string &code,
+                         const std::vector<std::string> &task_bad_code_regex) {
+  // clang-format off
+  static std::vector<std::string> bad_code_regex = {
+      // spawn process:
+      "system", "execl", "execlp", "execle", "execv", "execvp", "execvpe",
+      "fork",
+      // inline assembly:
+      "\\basm",
+      // overriding main:
+      "\\bmain\\b", "argv", "argc", "\\b_main\\b", "\\bstart\\b",
+      // abusive memory:
+      "calloc", "malloc", "free", "\\bnew\\b", "\\bmmap\\b",
+      // multithrading:
+      "pthread", "async", "launch", "thread",
+      // File IO
+      "fstream", "fopen", "fputc", "filesystem", "directory_iterator", "dirent", "opendir", "readdir", "fread", "fwrite",
+      // Stdin/stdout
+      "printf", "puts", "fputs", "putc", "\\bcout\\b", "\\bcerr\\b", "\\bcin\\b",
+  };
+  static std::vector<std::string> bad_code_plain = {
+      // Digraphs and preprocessor
+      "<%", "%>", "<:", ":>", "%:", "%:%:", "#",
+  };
+  // clang-format on
+  for (const std::string &regex : bad_code_regex) {
+    if (contains_regex(code, regex)) {
+      return false;
+    }
+  }
+  for (const std::string &plain : bad_code_plain) {
+    if (contains(code, plain)) {
+      return false;
+    }
+  }
+  for (const std::string &regex : task_bad_code_regex) {
+    if (contains_regex(code, regex)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool validate_flags(const std::string &flags) {
+  // clang-format off
+  static std::vector<std::string> bad_flags = {
+    ";", "&&", "||", "|", "&", ".", "/", "<", ">"
+  };
+  // clang-format on
+  for (const std::string &str : bad_flags) {
+    if (contains(flags, str)) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Rejects code that uses forbidden functions, headers or preprocessor
+// directives, in general and for the task.
+bool validate_code_input(const std::string &code,
+                         const std::vector<std::string> &task_bad_code_regex);
+
+// Rejects compiler flags that could inject shell commands or paths.
+bool validate_flags(const std::string &flags);
@@ -0,0 +1,103 @@
+#include "pipeline.hpp"
+#include "worker_protocol.hpp"
+
+#define CXXOPTS_NO_REGEX true
+#include <cxxopts.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+// Benchmark worker: connects to a server started with --worker-listen and
+// registers with the server's --worker-token, then compiles and benchmarks the
+// submissions it is sent, one at a time, and returns the results. The server
+// waits for each result as long as this worker's limits allow. Run it from the
+// repository root, as it uses runtime/compile.sh. Several workers may share a
+// machine; give each one its own --benchmark-core so their runs do not
+// overlap.
+
+int main(int argc, char **argv) {
+  // clang-format off
+  cxxopts::Options options("ClassroomPerfWorker", "Classroom performance competition benchmark worker");
+  options.add_options()
+    ("server", "Server address (unix:<path> or <host>:<port>).", cxxopts::value<std::string>())
+    ("worker-token", "Token the server was started with.", cxxopts::value<std::string>()->default_value(""))
+    ("name", "Worker name shown in the server log (default: <hostname>-<pid>).", cxxopts::value<std::string>()->default_value(""))
+    ("work-dir", "Directory submissions are compiled and run in.", cxxopts::value<std::string>()->default_value("work"))
+    ("benchmark-attempts", "Maximum benchmark runs when runs are noisy.", cxxopts::value<int>()->default_value("3"))
+    ("max-involuntary-switches", "Involuntary context switches above which a run is noisy.", cxxopts::value<long>()->default_value("10"))
+    ("max-system-time", "Fraction of CPU time in the kernel above which a run is noisy.", cxxopts::value<double>()->default_value("0.05"))
+    ("max-calibration-drift", "Relative calibration change across a run above which it is rejected.", cxxopts::value<double>()->default_value("0.05"))
+    ("compile-timeout", "Seconds a submission may take to compile.", cxxopts::value<double>()->default_value("60"))
+    ("benchmark-core", "Pin benchmarks to this core (-1: no pinning).", cxxopts::value<int>()->default_value("-1"))
+    ("h,help", "Print usage.")
+    ;
+  options.parse_positional({"server"});
+  // clang-format on
+
+  auto args = options.parse(argc, argv);
+  if (args.count("help") || !args.count("server")) {
+    std::cout << options.help() << std::endl;
+    std::exit(args.count("help") ? 0 : 1);
+  }
+
+  benchmark_policy settings;
+  settings.max_attempts = args["benchmark-attempts"].as<int>();
+  settings.max_involuntary_switches =
+      args["max-involuntary-switches"].as<long>();
+  settings.max_system_time_fraction = args["max-system-time"].as<double>();
+  settings.max_calibration_drift = args["max-calibration-drift"].as<double>();
+  settings.cpu = args["benchmark-core"].as<int>();
+  settings.compile_timeout_seconds = args["compile-timeout"].as<double>();
+
+  std::string server = args["server"].as<std::string>();
+  std::string token = args["worker-token"].as<std::string>();
+  std::string name = args["name"].as<std::string>();
+  if (name.empty()) {
+    char host[256] = "worker";
+    gethostname(host, sizeof(host) - 1);
+    name = std::string(host) + "-" + std::to_string(getpid());
+  }
+  std::filesystem::path work_root = args["work-dir"].as<std::string>();
+  worker_hello hello;
+  hello.name = name;
+  hello.job_seconds = max_pipeline_seconds(settings);
+
+  while (true) {
+    int fd = connect_socket(server);
+    if (fd < 0 ||
+        !write_frame(fd, frame_type::hello, hello_payload(token, hello))) {
+      if (fd >= 0) {
+        close(fd);
+      }
+      std::this_thread::sleep_for(std::chrono::seconds(2));
+      continue;
+    }
+    std::printf("Worker %s connected to %s.\n", name.c_str(), server.c_str());
+    std::fflush(stdout);
+
+    frame_type type;
+    std::string payload;
+    while (read_frame(fd, type, payload) && type == frame_type::job) {
+      submission_record record;
+      if (!record.decode(payload)) {
+        std::printf("Malformed job, disconnecting.\n");
+        break;
+      }
+      pipeline_job job = pipeline_job::from_record(record);
+      std::printf("Job %s/%s\n", job.task.c_str(), job.submission_id.c_str());
+      submission_record result = run_pipeline(job, settings, work_root);
+      std::fflush(stdout);
+      if (!write_frame(fd, frame_type::result, result.encode())) {
+        break;
+      }
+    }
+    close(fd);
+    std::printf("Disconnected from %s, reconnecting.\n", server.c_str());
+    std::this_thread::sleep_for(std::chrono::seconds(2));
+  }
+}
@@ -0,0 +1,277 @@
+#include "worker_protocol.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr uint32_t frame_magic = 0x31575043;  // "CPW1"
+
+bool write_all(int fd, const char *data, size_t size) {
+  while (size > 0) {
+    ssize_t n = send(fd, data, size, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+using deadline_clock = std::chrono::steady_clock;
+
+// Waits until fd is readable; false once the deadline has passed. A default
+// deadline means no limit.
+bool wait_readable(int fd, deadline_clock::time_point deadline) {
+  if (deadline == deadline_clock::time_point()) {
+    return true;
+  }
+  while (true) {
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - deadline_clock::now());
+    if (left.count() <= 0) {
+      return false;
+    }
+    pollfd p{fd, POLLIN, 0};
+    int n = poll(&p, 1, int(std::min<long long>(left.count(), 60000)));
+    if (n > 0) {
+      return true;
+    }
+    if (n < 0 && errno != EINTR) {
+      return false;
+    }
+  }
+}
+
+bool read_all(int fd, char *data, size_t size,
+              deadline_clock::time_point deadline) {
+  while (size > 0) {
+    if (!wait_readable(fd, deadline)) {
+      return false;
+    }
+    ssize_t n = recv(fd, data, size, 0);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+template <typename T>
+void put_le(char *out, T value) {
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    out[i] = char((value >> (8 * i)) & 0xff);
+  }
+}
+
+template <typename T>
+T get_le(const char *in) {
+  T value = 0;
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    value |= T(uint8_t(in[i])) << (8 * i);
+  }
+  return value;
+}
+
+// Splits "unix:<path>" or "<host>:<port>"; fills a unix address or resolves
+// the TCP one.
+struct socket_address {
+  bool unix_socket{false};
+  sockaddr_un un{};
+  addrinfo *tcp{nullptr};
+
+  ~socket_address() {
+    if (tcp) {
+      freeaddrinfo(tcp);
+    }
+  }
+
+  bool parse(const std::string &address, bool passive) {
+    if (address.compare(0, 5, "unix:") == 0) {
+      std::string path = address.substr(5);
+      if (path.empty() || path.size() >= sizeof(un.sun_path)) {
+        std::fprintf(stderr, "Invalid socket path: %s\n", path.c_str());
+        return false;
+      }
+      unix_socket = true;
+      un.sun_family = AF_UNIX;
+      std::memcpy(un.sun_path, path.c_str(), path.size() + 1);
+      return true;
+    }
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos) {
+      std::fprintf(stderr, "Invalid address (unix:<path> or <host>:<port>): %s\n",
+                   address.c_str());
+      return false;
+    }
+    std::string host = address.substr(0, colon);
+    std::string port = address.substr(colon + 1);
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = passive ? AI_PASSIVE : 0;
+    int err = getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(),
+                          &hints, &tcp);
+    if (err != 0) {
+      std::fprintf(stderr, "Cannot resolve %s: %s\n", address.c_str(),
+                   gai_strerror(err));
+      return false;
+    }
+    return true;
+  }
+};
+
+}  // namespace
+
+bool write_frame(int fd, frame_type type, const std::string &payload) {
+  char header[16];
+  put_le<uint32_t>(header, frame_magic);
+  put_le<uint32_t>(header + 4, uint32_t(type));
+  put_le<uint64_t>(header + 8, payload.size());
+  return write_all(fd, header, sizeof(header)) &&
+         write_all(fd, payload.data(), payload.size());
+}
+
+bool read_frame(int fd, frame_type &type, std::string &payload,
+                double timeout_seconds, uint64_t max_size) {
+  deadline_clock::time_point deadline;
+  if (timeout_seconds > 0) {
+    deadline = deadline_clock::now() +
+               std::chrono::duration_cast<deadline_clock::duration>(
+                   std::chrono::duration<double>(timeout_seconds));
+  }
+  char header[16];
+  if (!read_all(fd, header, sizeof(header), deadline) ||
+      get_le<uint32_t>(header) != frame_magic) {
+    return false;
+  }
+  type = frame_type(get_le<uint32_t>(header + 4));
+  uint64_t size = get_le<uint64_t>(header + 8);
+  if (size > max_size) {
+    return false;
+  }
+  payload.resize(size);
+  return read_all(fd, payload.data(), size, deadline);
+}
+
+std::string hello_payload(const std::string &token, const worker_hello &hello) {
+  return token + "\n" + std::to_string(hello.job_seconds) + "\n" + hello.name;
+}
+
+bool check_hello(const std::string &payload, const std::string &token,
+                 worker_hello &hello) {
+  size_t newline = payload.find('\n');
+  size_t name_start = payload.find('\n', newline + 1);
+  if (newline == std::string::npos || newline != token.size() ||
+      name_start == std::string::npos) {
+    return false;
+  }
+  std::string seconds = payload.substr(newline + 1, name_start - newline - 1);
+  char *end = nullptr;
+  hello.job_seconds = std::strtod(seconds.c_str(), &end);
+  // At most a day; anything else is a malformed hello.
+  if (seconds.empty() || *end != '\0' ||
+      !(hello.job_seconds > 0 && hello.job_seconds <= 86400)) {
+    return false;
+  }
+  // Compares every byte, so the time taken does not reveal the matching
+  // prefix.
+  unsigned char diff = 0;
+  for (size_t i = 0; i < token.size(); ++i) {
+    diff |= payload[i] ^ token[i];
+  }
+  hello.name = payload.substr(name_start + 1);
+  return diff == 0;
+}
+
+int listen_socket(const std::string &address) {
+  socket_address a;
+  if (!a.parse(address, true)) {
+    return -1;
+  }
+  int fd = -1;
+  if (a.unix_socket) {
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    unlink(a.un.sun_path);  // stale socket of a previous run
+    if (fd >= 0 && bind(fd, (sockaddr *)&a.un, sizeof(a.un)) != 0) {
+      close(fd);
+      fd = -1;
+    }
+  } else {
+    for (addrinfo *ai = a.tcp; ai && fd < 0; ai = ai->ai_next) {
+      fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC,
+                  ai->ai_protocol);
+      int one = 1;
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+      if (fd >= 0 && bind(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+        close(fd);
+        fd = -1;
+      }
+    }
+  }
+  if (fd < 0 || listen(fd, 16) != 0) {
+    std::fprintf(stderr, "Cannot listen on %s: %s\n", address.c_str(),
+                 std::strerror(errno));
+    if (fd >= 0) {
+      close(fd);
+    }
+    return -1;
+  }
+  return fd;
+}
+
+int connect_socket(const std::string &address) {
+  socket_address a;
+  if (!a.parse(address, false)) {
+    return -1;
+  }
+  int fd = -1;
+  if (a.unix_socket) {
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, (sockaddr *)&a.un, sizeof(a.un)) != 0) {
+      close(fd);
+      fd = -1;
+    }
+  } else {
+    for (addrinfo *ai = a.tcp; ai && fd < 0; ai = ai->ai_next) {
+      fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC,
+                  ai->ai_protocol);
+      if (fd >= 0 && connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+        close(fd);
+        fd = -1;
+      }
+      if (fd >= 0) {
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        // Notices a server that went away without closing the connection.
+        setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &one, sizeof(one));
+      }
+    }
+  }
+  if (fd < 0) {
+    std::fprintf(stderr, "Cannot connect to %s: %s\n", address.c_str(),
+                 std::strerror(errno));
+  }
+  return fd;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Protocol between the server and its benchmark workers. A worker connects to
+// the server, sends hello, and from then on receives one job at a time and
+// answers each with its result. Every message is a frame:
+//
+//   u32 magic "CPW1"
+//   u32 type
+//   u64 payload size
+//   payload
+//
+// Job and result payloads are encoded submission records (see
+// pipeline_job::to_record() and run_pipeline()); the hello payload is
+// "<token>\n<job seconds>\n<worker name>", where job seconds is the longest a
+// job may take on the worker (max_pipeline_seconds() of its settings). The
+// server stores the results a worker returns, so it only accepts workers that
+// know its --worker-token. Integers are little endian.
+enum class frame_type : uint32_t {
+  hello = 1,
+  job = 2,
+  result = 3,
+};
+
+bool write_frame(int fd, frame_type type, const std::string &payload);
+// Fails if the frame is not complete within timeout_seconds (0: no limit) or
+// its payload exceeds max_size.
+bool read_frame(int fd, frame_type &type, std::string &payload,
+                double timeout_seconds = 0,
+                uint64_t max_size = uint64_t(1) << 30);
+
+struct worker_hello {
+  std::string name;
+  double job_seconds{0};
+};
+
+std::string hello_payload(const std::string &token, const worker_hello &hello);
+// Parses the hello if it carries the expected token.
+bool check_hello(const std::string &payload, const std::string &token,
+                 worker_hello &hello);
+
+// Addresses are "unix:<path>" or "<host>:<port>". Both return a socket file
+// descriptor, or -1 with a message on stderr.
+int listen_socket(const std::string &address);
+int connect_socket(const std::string &address);